@@ -5,8 +5,12 @@
 #ifndef STANDARDESE_COMMENT_HPP_INCLUDED
 #define STANDARDESE_COMMENT_HPP_INCLUDED
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <standardese/comment/config.hpp>
 #include <standardese/comment/doc_comment.hpp>
@@ -25,10 +29,13 @@ namespace standardese
     /// The registry of the comments for all entities.
     ///
     /// It also stores all member groups.
+    /// The comments are never moved once registered,
+    /// so references to them stay valid until the registry is destroyed.
     class comment_registry
     {
     public:
         /// \effects Registers everything from the other comment registry.
+        /// \notes The members of groups with the same name are combined.
         void merge(comment_registry&& other);
 
         /// \effects Registers the comment for the given entity.
@@ -67,7 +74,24 @@ namespace standardese
         }
 
     private:
-        std::unordered_map<const cppast::cpp_entity*, comment::doc_comment> map_;
+        struct slot
+        {
+            const cppast::cpp_entity* entity; //< null if the slot is free
+            std::size_t               index;  //< index of its comment
+        };
+
+        // returns the slot of the entity, or the free slot where it would be inserted
+        std::size_t find_slot(const cppast::cpp_entity* entity) const noexcept;
+
+        void insert(const cppast::cpp_entity* entity, comment::doc_comment comment);
+
+        // ensures there are enough slots for the given number of comments
+        void rehash(std::size_t no_comments);
+
+        // comments are looked up for almost every entity,
+        // so use open addressing over the entity pointers with linear probing
+        std::deque<comment::doc_comment> comments_;
+        std::vector<slot>                slots_; //< size is zero or a power of two
         std::unordered_map<std::string,
                            std::vector<type_safe::object_ref<const cppast::cpp_entity>>>
                                                               groups_;
@@ -77,6 +101,30 @@ namespace standardese
     /// \returns The unique name of the given entity.
     std::string lookup_unique_name(const comment_registry& registry, const cppast::cpp_entity& e);
 
+    /// Memoizes the unique names of entities.
+    ///
+    /// The unique name of an entity is based on the one of its parent,
+    /// so each parent's name is only computed once instead of for every child.
+    /// \notes The comments of the entities and their parents must not change
+    /// once their unique names are looked up.
+    class unique_name_table
+    {
+    public:
+        explicit unique_name_table(const comment_registry& registry) : registry_(&registry) {}
+
+        /// \returns The unique name of the given entity,
+        /// the same as [standardese::lookup_unique_name]().
+        /// \notes The reference is valid as long as the table.
+        const std::string& lookup(const cppast::cpp_entity& e);
+
+    private:
+        // the name the unique names of the entity and its siblings are based on
+        const std::string& lookup_parent(const cppast::cpp_entity& e);
+
+        const comment_registry*                                     registry_;
+        std::unordered_map<const cppast::cpp_entity*, std::string> names_, parent_names_;
+    };
+
     /// Parses the comments in a file.
     class file_comment_parser
     {
@@ -84,8 +132,22 @@ namespace standardese
         /// \effects Gives it the logger and comment configuration.
         explicit file_comment_parser(type_safe::object_ref<const cppast::diagnostic_logger> logger,
                                      comment::config config = comment::config())
-        : config_(std::move(config)), logger_(logger)
+        : cache_memory_(0u),
+          cache_limit_(64u * 1024u * 1024u),
+          cache_hits_(0u),
+          cache_misses_(0u),
+          config_(std::move(config)),
+          logger_(logger)
+        {
+        }
+
+        /// \effects Sets the estimated memory in bytes that may be used
+        /// to keep the parsed comments of repeated texts, `0` disables the cache.
+        /// The default is 64MiB.
+        /// \requires This function must not be called while `parse()` is running.
+        void set_cache_limit(std::uint64_t limit) noexcept
         {
+            cache_limit_ = limit;
         }
 
         /// \effects Parses all comments in the given file.
@@ -98,25 +160,54 @@ namespace standardese
         /// and you must not call `parse()` afterwards.
         comment_registry finish();
 
-    private:
-        bool register_commented(type_safe::object_ref<const cppast::cpp_entity> entity,
-                                comment::doc_comment comment, bool allow_cmd = true) const;
-
-        void register_uncommented(type_safe::object_ref<const cppast::cpp_entity> entity) const;
-
-        type_safe::optional_ref<const comment::doc_comment> get_comment(
-            const cppast::cpp_entity& e) const
+        /// \returns The number of entity comments whose text was parsed before,
+        /// so the previous result was copied.
+        /// \notes Only the texts that were seen at least twice are cached,
+        /// so the first repetition is a miss as well.
+        std::size_t cache_hits() const noexcept
         {
-            std::lock_guard<std::mutex> lock(mutex_);
-            return registry_.get_comment(e);
+            return cache_hits_;
         }
 
-        std::string get_parent_unique_name(const cppast::cpp_entity& e) const;
+        /// \returns The number of entity comments that had to be parsed.
+        std::size_t cache_misses() const noexcept
+        {
+            return cache_misses_;
+        }
 
-        mutable std::mutex                                                      mutex_;
-        mutable std::unordered_multimap<std::string, const cppast::cpp_entity*> uncommented_;
-        mutable comment_registry                                                registry_;
-        mutable std::vector<comment::parse_result>                              free_comments_;
+    private:
+        // the comments of a single file,
+        // filled without locking and merged in finish()
+        struct shard
+        {
+            comment_registry                                                registry;
+            std::unordered_multimap<std::string, const cppast::cpp_entity*> uncommented;
+            std::vector<comment::parse_result>                              free_comments;
+        };
+
+        // parses the comment of an entity unless the same text was parsed before
+        comment::parse_result parse_cached(const comment::parser& p,
+                                           const std::string&     text) const;
+
+        static bool register_commented(shard& s, unique_name_table& names,
+                                       type_safe::object_ref<const cppast::cpp_entity> entity,
+                                       comment::doc_comment comment, bool allow_cmd = true);
+
+        static void register_uncommented(shard& s, unique_name_table& names,
+                                         type_safe::object_ref<const cppast::cpp_entity> entity);
+
+        mutable std::mutex         mutex_;
+        mutable std::vector<shard> shards_;
+        mutable comment_registry   modules_; //< the module comments of all files
+
+        // most comments are unique, so only the hashes of texts parsed once are remembered,
+        // and the result is kept when the text is parsed the second time
+        mutable std::mutex                                             cache_mutex_;
+        mutable std::unordered_set<std::size_t>                        seen_;
+        mutable std::unordered_map<std::string, comment::parse_result> cache_;
+        mutable std::uint64_t                                          cache_memory_;
+        std::uint64_t                                                  cache_limit_;
+        mutable std::atomic<std::size_t>                               cache_hits_, cache_misses_;
 
         comment::config                                        config_;
         type_safe::object_ref<const cppast::diagnostic_logger> logger_;
@@ -6,7 +6,9 @@
 #define STANDARDESE_COMMENT_CONFIG_HPP_INCLUDED
 
 #include <array>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <standardese/comment/commands.hpp>
 
@@ -73,18 +75,46 @@ namespace standardese
             /// \returns The command or section corresponding to the given command string,
             /// or an invalid value, if it doesn't belong to anything.
             /// The command string does not contain the leading command character.
+            /// \notes The lookup uses a trie over the command names,
+            /// so it is linear in the length of the string.
             unsigned try_lookup(const char* name) const noexcept;
 
+            /// \returns The same as the other overload,
+            /// but the command string is given by its first `length` characters.
+            unsigned try_lookup(const char* name, std::size_t length) const noexcept;
+
             /// \returns The name of a [standardese::markup::inline_section]().
             const char* inline_section_name(section_type section) const noexcept;
 
             /// \returns The name of a [standardese::markup::list_section]().
             const char* list_section_name(section_type section) const noexcept;
 
+            friend bool operator==(const config& lhs, const config& rhs)
+            {
+                return lhs.command_character_ == rhs.command_character_
+                       && lhs.command_names_ == rhs.command_names_
+                       && lhs.inline_sections_ == rhs.inline_sections_
+                       && lhs.list_sections_ == rhs.list_sections_;
+            }
+            friend bool operator!=(const config& lhs, const config& rhs)
+            {
+                return !(rhs == lhs);
+            }
+
         private:
+            struct trie_node
+            {
+                unsigned first_child, last_child; //< range of the children in the trie
+                unsigned command; //< the command whose name ends here or invalid
+                char     c;       //< the character of the edge to the node
+            };
+
+            void build_trie();
+
             std::array<std::string, unsigned(inline_type::count)>  command_names_;
             std::array<std::string, unsigned(section_type::count)> inline_sections_;
             std::array<std::string, unsigned(section_type::count)> list_sections_;
+            std::vector<trie_node>                                 trie_;
             char                                                   command_character_;
         };
     }
@@ -101,6 +101,9 @@ namespace standardese
         /// which aren't set in `data`.
         doc_comment merge(metadata data, doc_comment&& other);
 
+        /// \returns A deep copy of the comment.
+        doc_comment clone(const doc_comment& comment);
+
         /// \effects Adds a copy of the sections to the documentation builder.
         /// \group set_sections
         void set_sections(markup::entity_documentation::builder& builder,
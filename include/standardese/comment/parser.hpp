@@ -59,6 +59,13 @@ namespace standardese
             cmark_parser*   parser_;
         };
 
+        /// \returns A parser using the given configuration that belongs to the calling thread.
+        /// \notes It is created the first time the configuration is used on the thread,
+        /// and reused afterwards, as creating a parser is expensive.
+        /// It must not be used by other threads
+        /// and is only valid until the thread requests parsers for multiple other configurations.
+        const parser& get_thread_parser(const comment::config& c);
+
         /// An unmatched documentation comment.
         ///
         /// That is, a comment not yet associated with an entity
@@ -83,6 +90,9 @@ namespace standardese
             std::vector<unmatched_doc_comment> inlines; //< The inline entities.
         };
 
+        /// \returns A deep copy of the result.
+        parse_result clone(const parse_result& result);
+
         /// A parse error.
         class parse_error : public std::runtime_error
         {
@@ -114,6 +124,27 @@ namespace standardese
         /// \returns The parsed comment.
         /// \throws [standardese::comment::parse_error]() if an error occurred.
         parse_result parse(const parser& p, const std::string& comment, bool has_matching_entity);
+
+        namespace detail
+        {
+            /// \returns Whether the comment is a single line of text without markup or commands.
+            /// Such a comment only consists of a brief section with the text,
+            /// so [standardese::comment::parse]() doesn't need the CommonMark parser for it.
+            /// \notes This has false negatives but no false positives.
+            bool is_plain_brief(const config& c, const std::string& comment) noexcept;
+
+            /// Parses the comment using the CommonMark parser,
+            /// even if it is a plain brief comment.
+            /// \returns The same as [standardese::comment::parse]().
+            /// \throws [standardese::comment::parse_error]() if an error occurred.
+            parse_result parse_cmark(const parser& p, const std::string& comment,
+                                     bool has_matching_entity);
+        } // namespace detail
+
+        /// Parses the comment using the parser of the calling thread.
+        /// \effects Same as `parse(get_thread_parser(c), comment, has_matching_entity)`.
+        parse_result parse(const comment::config& c, const std::string& comment,
+                           bool has_matching_entity);
     }
 } // namespace standardese::comment
 
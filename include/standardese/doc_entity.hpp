@@ -6,7 +6,15 @@
 #define STANDARDESE_DOC_ENTITY_HPP_INCLUDED
 
 #include <cassert>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <cppast/cpp_entity.hpp>
 #include <cppast/cpp_namespace.hpp>
@@ -20,6 +28,8 @@
 
 namespace standardese
 {
+    class synopsis_reference_table;
+
     /// The configuration of the synopsis.
     class synopsis_config
     {
@@ -87,10 +97,25 @@ namespace standardese
             flags_.set(f, val);
         }
 
+        /// \returns The table of the entities the synopsis refers to, if there is one.
+        type_safe::optional_ref<const synopsis_reference_table> references() const noexcept
+        {
+            return references_;
+        }
+
+        /// \effects Sets the table of the entities the synopsis refers to.
+        /// If there is one, the synopsis takes the information about them from the table
+        /// instead of their doc entities.
+        void set_references(type_safe::optional_ref<const synopsis_reference_table> table) noexcept
+        {
+            references_ = table;
+        }
+
     private:
-        std::string hidden_name_;
-        unsigned    tab_width_;
-        flags       flags_;
+        std::string                                             hidden_name_;
+        unsigned                                                tab_width_;
+        flags                                                   flags_;
+        type_safe::optional_ref<const synopsis_reference_table> references_;
     };
 
     /// The configuration of the generated documentation.
@@ -143,9 +168,30 @@ namespace standardese
             order_ = order;
         }
 
+        /// Runs independent tasks of the documentation generation.
+        ///
+        /// It must run every task exactly once and only return after all of them are finished,
+        /// the tasks can run in parallel.
+        using task_executor = std::function<void(const std::vector<std::function<void()>>&)>;
+
+        /// \returns The executor, it is empty if the tasks are run sequentially.
+        const task_executor& executor() const noexcept
+        {
+            return executor_;
+        }
+
+        /// \effects Sets the executor used to generate the documentation
+        /// of the children of files and namespaces.
+        /// By default, they are generated sequentially on the calling thread.
+        void set_executor(task_executor executor)
+        {
+            executor_ = std::move(executor);
+        }
+
     private:
         flags               flags_;
         entity_index::order order_;
+        task_executor       executor_;
     };
 
     namespace detail
@@ -168,9 +214,72 @@ namespace standardese
             }
         };
 
+        /// A monotonic allocator for the doc entities of a file.
+        ///
+        /// Memory is only freed when the arena is destroyed,
+        /// so allocating the entities doesn't call the heap for each of them.
+        /// \notes The entities are still destroyed one by one through their owners,
+        /// and the members they own on the heap are freed then;
+        /// the arena only saves the allocation of the entities themselves.
+        class doc_entity_arena
+        {
+        public:
+            doc_entity_arena() noexcept : cur_(nullptr), end_(nullptr), finalizers_(nullptr) {}
+
+            /// \effects Destroys all objects created in the arena and frees the memory.
+            ~doc_entity_arena() noexcept;
+
+            doc_entity_arena(const doc_entity_arena&) = delete;
+            doc_entity_arena& operator=(const doc_entity_arena&) = delete;
+
+            /// \returns Memory of the given size that is suitably aligned for any type.
+            void* allocate(std::size_t size);
+
+            /// \effects Creates an object in the arena,
+            /// it is destroyed together with the arena.
+            template <typename T, typename... Args>
+            T& create(Args&&... args)
+            {
+                auto f = ::new (allocate(sizeof(finalizer))) finalizer;
+                auto object = ::new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+
+                f->destroy  = [](void* ptr) { static_cast<T*>(ptr)->~T(); };
+                f->object   = object;
+                f->next     = finalizers_;
+                finalizers_ = f;
+
+                return *object;
+            }
+
+        private:
+            struct finalizer
+            {
+                void (*destroy)(void*);
+                void*      object;
+                finalizer* next;
+            };
+
+            std::vector<std::unique_ptr<char[]>> blocks_;
+            char*                                cur_;
+            char*                                end_;
+            finalizer*                           finalizers_;
+        };
+
         class markdown_code_generator;
     } // namespace detail
 
+    /// A part of the documentation of a file that is written to its own document.
+    ///
+    /// It is created by the overload of [standardese::generate_documentation]() that splits a file.
+    struct documentation_page
+    {
+        std::string title; //< name of the class or namespace, or the output section
+        std::string name;  //< link name of the first documented entity, unique in the file
+        std::vector<std::unique_ptr<markup::entity_documentation>> documentations;
+    };
+
+    class doc_cpp_file;
+
     /// A documentation entity.
     ///
     /// It combines the [cppast::cpp_entity]() with the [comment::doc_comment]().
@@ -206,7 +315,7 @@ namespace standardese
         /// \returns The link name of the entity.
         const std::string& link_name() const noexcept
         {
-            return link_name_;
+            return *link_name_;
         }
 
         /// \returns The id of the block where the entity is documented.
@@ -253,10 +362,33 @@ namespace standardese
             injected_ = true;
         }
 
+        /// \effects Allocates an entity on the heap.
+        /// \notes Each allocation has a small header in front of the entity,
+        /// it records whether the entity was allocated in an arena.
+        static void* operator new(std::size_t size);
+
+        /// \effects Allocates an entity in the arena,
+        /// the memory is freed together with the arena, not when the entity is deleted.
+        static void* operator new(std::size_t size, detail::doc_entity_arena& arena);
+
+        /// \effects Frees the memory of an entity, if it wasn't allocated in an arena.
+        static void operator delete(void* ptr) noexcept;
+
+        static void operator delete(void* ptr, detail::doc_entity_arena& arena) noexcept;
+
     private:
         doc_entity(std::string                                         link_name,
                    type_safe::optional_ref<const comment::doc_comment> comment)
-        : link_name_(std::move(link_name)), comment_(comment)
+        : link_name_storage_(std::move(link_name)),
+          link_name_(type_safe::cref(link_name_storage_)),
+          comment_(comment)
+        {
+        }
+
+        // borrows the link name, it must live as long as the entity
+        doc_entity(type_safe::object_ref<const std::string>            link_name,
+                   type_safe::optional_ref<const comment::doc_comment> comment)
+        : link_name_(link_name), comment_(comment)
         {
         }
 
@@ -306,9 +438,9 @@ namespace standardese
         /// \exclude
         virtual std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const = 0;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const = 0;
 
         /// \exclude
         virtual cppast::code_generator::generation_options do_get_generation_options(
@@ -326,7 +458,8 @@ namespace standardese
         /// \exclude
         virtual void do_generate_code(cppast::code_generator& generator) const = 0;
 
-        std::string                                         link_name_;
+        std::string                                         link_name_storage_;
+        type_safe::object_ref<const std::string>            link_name_;
         std::vector<std::unique_ptr<doc_entity>>            children_;
         type_safe::optional_ref<const doc_entity>           parent_;
         type_safe::optional_ref<const comment::doc_comment> comment_;
@@ -340,6 +473,10 @@ namespace standardese
         friend std::unique_ptr<markup::documentation_entity> generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
             const cppast::cpp_entity_index& index, const doc_entity& entity);
+        friend std::unique_ptr<markup::documentation_entity> generate_documentation(
+            const generation_config& gen_config, const synopsis_config& syn_config,
+            const cppast::cpp_entity_index& index, const doc_cpp_file& file,
+            std::vector<documentation_page>& pages);
 
         friend class doc_excluded_entity;
         friend class doc_cpp_entity;
@@ -349,8 +486,42 @@ namespace standardese
         friend class doc_cpp_file;
     };
 
+    /// The information the synopsis needs about the entities it refers to.
+    ///
+    /// It allows generating the synopsis of a file after the files it refers to were destroyed,
+    /// see [standardese::synopsis_config::set_references]().
+    class synopsis_reference_table
+    {
+    public:
+        /// The information about an entity.
+        struct reference
+        {
+            std::string link_name;
+            bool        documented; //< whether it has documentation to link to
+            bool        excluded;
+        };
+
+        /// \effects Registers all entities of the file that have a [standardese::doc_entity]().
+        /// \requires The doc entities of all files must be built,
+        /// and the injected entities registered.
+        /// \notes This function is thread safe.
+        void register_file(const cppast::cpp_file& file);
+
+        /// \returns The information about the entity, if it was registered.
+        /// \requires No file may be registered concurrently.
+        /// \notes The entity is only used as key, so it may have been destroyed already.
+        type_safe::optional_ref<const reference> lookup(const cppast::cpp_entity* entity) const;
+
+    private:
+        std::mutex                                                mutex_;
+        std::unordered_map<const cppast::cpp_entity*, reference> references_;
+    };
+
     /// Generates synopsis for that entity.
     /// \returns The synopsis of that entity.
+    /// \notes The code is generated anew for every call,
+    /// the synopsis of a class doesn't reuse the synopses of its members or vice versa:
+    /// there the members are declarations that link to their documentation.
     std::unique_ptr<markup::code_block> generate_synopsis(const synopsis_config&          config,
                                                           const cppast::cpp_entity_index& index,
                                                           const doc_entity&               entity);
@@ -361,6 +532,18 @@ namespace standardese
         const generation_config& gen_config, const synopsis_config& syn_config,
         const cppast::cpp_entity_index& index, const doc_entity& entity);
 
+    /// Generates documentation for that file, giving classes, namespaces and output sections their own page.
+    /// \effects The documentation of every class or namespace in the file or one of its namespaces
+    /// is moved to a new page, as is the documentation of the entities of an output section,
+    /// up until the next class, namespace or output section.
+    /// The pages are appended to `pages`, nested pages follow the page of their namespace.
+    /// \returns The documentation of the file with the remaining entities,
+    /// and a summary of the pages.
+    std::unique_ptr<markup::documentation_entity> generate_documentation(
+        const generation_config& gen_config, const synopsis_config& syn_config,
+        const cppast::cpp_entity_index& index, const doc_cpp_file& file,
+        std::vector<documentation_page>& pages);
+
     /// Documentation entity that is being marked as excluded.
     ///
     /// This will be the user data of all excluded [cppast::cpp_entity]().
@@ -383,7 +566,7 @@ namespace standardese
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config&, const synopsis_config&, const cppast::cpp_entity_index&,
             type_safe::optional_ref<detail::inline_entity_list>,
-            std::unique_ptr<markup::code_block>) const override
+            type_safe::optional_ref<std::vector<documentation_page>>) const override
         {
             return nullptr;
         }
@@ -409,6 +592,14 @@ namespace standardese
         public:
             builder(std::string link_name, type_safe::object_ref<const cppast::cpp_entity> entity,
                     type_safe::optional_ref<const comment::doc_comment> comment);
+
+            /// \effects Builds the entity in the arena.
+            /// If `set_user_data` is `false`, the entity doesn't get it as user data yet.
+            /// \requires The link name must live as long as the entity.
+            builder(detail::doc_entity_arena& arena, const std::string& link_name,
+                    type_safe::object_ref<const cppast::cpp_entity>     entity,
+                    type_safe::optional_ref<const comment::doc_comment> comment,
+                    bool                                                set_user_data = true);
         };
 
         /// \returns The corresponding entity.
@@ -431,8 +622,8 @@ namespace standardese
         }
 
     private:
-        doc_cpp_entity(std::string                                         link_name,
-                       type_safe::object_ref<const cppast::cpp_entity>     entity,
+        template <typename LinkName>
+        doc_cpp_entity(LinkName link_name, type_safe::object_ref<const cppast::cpp_entity> entity,
                        type_safe::optional_ref<const comment::doc_comment> comment)
         : doc_entity(std::move(link_name), comment), entity_(entity)
         {
@@ -453,9 +644,9 @@ namespace standardese
 
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const override;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const override;
 
         cppast::code_generator::generation_options do_get_generation_options(
             const synopsis_config& config, bool is_main) const override;
@@ -485,6 +676,13 @@ namespace standardese
         public:
             builder(type_safe::object_ref<const cppast::cpp_entity>   entity,
                     type_safe::object_ref<const comment::doc_comment> comment);
+
+            /// \effects Builds the entity in the arena.
+            /// If `set_user_data` is `false`, the entity doesn't get it as user data yet.
+            builder(detail::doc_entity_arena&                         arena,
+                    type_safe::object_ref<const cppast::cpp_entity>   entity,
+                    type_safe::object_ref<const comment::doc_comment> comment,
+                    bool                                              set_user_data = true);
         };
 
         /// \returns The corresponding entity.
@@ -496,7 +694,7 @@ namespace standardese
     private:
         doc_metadata_entity(type_safe::object_ref<const cppast::cpp_entity>   entity,
                             type_safe::object_ref<const comment::doc_comment> comment)
-        : doc_entity(entity->name(), comment), entity_(entity)
+        : doc_entity(type_safe::ref(entity->name()), comment), entity_(entity)
         {
         }
 
@@ -512,9 +710,9 @@ namespace standardese
 
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const override;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const override;
 
         cppast::code_generator::generation_options do_get_generation_options(
             const synopsis_config& config, bool is_main) const override;
@@ -544,12 +742,23 @@ namespace standardese
             {
             }
 
-            void add_member(std::unique_ptr<doc_cpp_entity> member)
+            /// \effects Builds the group in the arena.
+            /// \requires The link name must live as long as the group.
+            builder(detail::doc_entity_arena& arena, const std::string& link_name)
+            : basic_builder(std::unique_ptr<doc_member_group_entity>(
+                  new (arena) doc_member_group_entity(type_safe::ref(link_name))))
+            {
+            }
+
+            /// \effects Adds a member,
+            /// the first one gets the group as user data unless `set_user_data` is `false`.
+            void add_member(std::unique_ptr<doc_cpp_entity> member, bool set_user_data = true)
             {
                 if (size() == 0u)
                 {
                     set_comment(member->comment());
-                    member->entity().set_user_data(&peek());
+                    if (set_user_data)
+                        member->entity().set_user_data(&peek());
                 }
                 member->group_member_no_ = unsigned(size() + 1u);
 
@@ -561,7 +770,8 @@ namespace standardese
         };
 
     private:
-        doc_member_group_entity(std::string link_name) : doc_entity(std::move(link_name), nullptr)
+        template <typename LinkName>
+        doc_member_group_entity(LinkName link_name) : doc_entity(std::move(link_name), nullptr)
         {
         }
 
@@ -577,9 +787,9 @@ namespace standardese
 
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const override;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const override;
 
         cppast::code_generator::generation_options do_get_generation_options(
             const synopsis_config& config, bool is_main) const override;
@@ -603,6 +813,12 @@ namespace standardese
             builder(std::string                                         link_name,
                     type_safe::object_ref<const cppast::cpp_namespace>  entity,
                     type_safe::optional_ref<const comment::doc_comment> comment);
+
+            /// \effects Builds the entity in the arena.
+            /// \requires The link name must live as long as the entity.
+            builder(detail::doc_entity_arena& arena, const std::string& link_name,
+                    type_safe::object_ref<const cppast::cpp_namespace>  entity,
+                    type_safe::optional_ref<const comment::doc_comment> comment);
         };
 
         /// \returns The corresponding namespace.
@@ -616,7 +832,8 @@ namespace standardese
         markup::namespace_documentation::builder get_builder() const;
 
     private:
-        doc_cpp_namespace(std::string                                         link_name,
+        template <typename LinkName>
+        doc_cpp_namespace(LinkName                                            link_name,
                           type_safe::object_ref<const cppast::cpp_namespace>  entity,
                           type_safe::optional_ref<const comment::doc_comment> comment)
         : doc_entity(std::move(link_name), comment), entity_(entity)
@@ -635,9 +852,9 @@ namespace standardese
 
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const override;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const override;
 
         cppast::code_generator::generation_options do_get_generation_options(
             const synopsis_config& config, bool is_main) const override;
@@ -664,8 +881,24 @@ namespace standardese
             builder(std::string output_name, std::string link_name,
                     std::unique_ptr<cppast::cpp_file>                   file,
                     type_safe::optional_ref<const comment::doc_comment> comment);
+
+            /// \effects Builds a file that owns the arena of its child entities.
+            /// \requires The link name must live as long as the arena.
+            builder(std::unique_ptr<detail::doc_entity_arena> arena, std::string output_name,
+                    const std::string& link_name, std::unique_ptr<cppast::cpp_file> file,
+                    type_safe::optional_ref<const comment::doc_comment> comment);
+
+            /// \effects Remembers a doc entity of an entity in another file,
+            /// like a member of a base class,
+            /// it becomes its user data in [standardese::register_injected_entities]().
+            void add_injected_entity(const cppast::cpp_entity& entity, doc_entity& doc)
+            {
+                peek().injected_.emplace_back(type_safe::ref(entity), type_safe::ref(doc));
+            }
         };
 
+        ~doc_cpp_file() noexcept override;
+
         /// \returns The corresponding file.
         /// It is owned by the doc entity.
         const cppast::cpp_file& file() const noexcept
@@ -679,13 +912,21 @@ namespace standardese
             return output_name_;
         }
 
+        /// \returns The files containing the entities of the injected doc entities,
+        /// without duplicates.
+        /// \notes The doc entities refer to the entities and the entities to the doc entities,
+        /// so the files can only be destroyed together with this one.
+        std::vector<const cppast::cpp_file*> get_injected_files() const;
+
     private:
-        doc_cpp_file(std::string output_name, std::string link_name,
-                     std::unique_ptr<cppast::cpp_file>                   file,
+        template <typename LinkName>
+        doc_cpp_file(std::unique_ptr<detail::doc_entity_arena> arena, std::string output_name,
+                     LinkName link_name, std::unique_ptr<cppast::cpp_file> file,
                      type_safe::optional_ref<const comment::doc_comment> comment)
         : doc_entity(std::move(link_name), comment),
           output_name_(std::move(output_name)),
-          file_(std::move(file))
+          file_(std::move(file)),
+          arena_(std::move(arena))
         {
         }
 
@@ -701,17 +942,23 @@ namespace standardese
 
         std::unique_ptr<markup::documentation_entity> do_generate_documentation(
             const generation_config& gen_config, const synopsis_config& syn_config,
-            const cppast::cpp_entity_index&                     index,
-            type_safe::optional_ref<detail::inline_entity_list> inlines,
-            std::unique_ptr<markup::code_block>                 synopsis) const override;
+            const cppast::cpp_entity_index&                          index,
+            type_safe::optional_ref<detail::inline_entity_list>      inlines,
+            type_safe::optional_ref<std::vector<documentation_page>> pages) const override;
 
         cppast::code_generator::generation_options do_get_generation_options(
             const synopsis_config& config, bool is_main) const override;
 
         void do_generate_code(cppast::code_generator& generator) const override;
 
-        std::string                       output_name_;
-        std::unique_ptr<cppast::cpp_file> file_;
+        std::string                               output_name_;
+        std::unique_ptr<cppast::cpp_file>         file_;
+        std::unique_ptr<detail::doc_entity_arena> arena_; //< owns the child entities, if any
+        std::vector<std::pair<type_safe::object_ref<const cppast::cpp_entity>,
+                              type_safe::object_ref<doc_entity>>>
+            injected_; //< doc entities of entities in other files
+
+        friend void register_injected_entities(const doc_cpp_file& file);
     };
 
     class comment_registry;
@@ -755,6 +1002,27 @@ namespace standardese
         type_safe::object_ref<const comment_registry> registry,
         const cppast::cpp_entity_index& index, std::unique_ptr<cppast::cpp_file> file,
         std::string output_name);
+
+    /// Creates the [standardese::doc_entity]() hierarchy and excludes entities in a single traversal.
+    /// \effects The same as [standardese::exclude_entities]() followed by [standardese::build_doc_entities](),
+    /// but it doesn't need the exclusion of the other files.
+    /// Whether entities of other files, like base classes, are excluded is computed
+    /// from the comments and the blacklist, the entities of other files aren't modified at all.
+    /// So multiple files can be built concurrently.
+    /// \returns The corresponding documentation file.
+    /// \notes The file output name is merely a suggestion, may be overriden by comment of file.
+    /// \notes The entities of other files that are injected into the file, like members of a base class,
+    /// only get their doc entities as user data in [standardese::register_injected_entities]().
+    std::unique_ptr<doc_cpp_file> build_doc_entities(
+        type_safe::object_ref<const comment_registry> registry,
+        const cppast::cpp_entity_index& index, const entity_blacklist& blacklist,
+        std::unique_ptr<cppast::cpp_file> file, std::string output_name);
+
+    /// \effects Sets the user data of the entities of other files that were injected into the file
+    /// to their doc entities.
+    /// \requires The files the entities belong to must not be built concurrently.
+    /// \notes If an entity is injected into multiple files, the file registered last wins.
+    void register_injected_entities(const doc_cpp_file& file);
 } // namespace standardese
 
 #endif // STANDARDESE_DOC_ENTITY_HPP_INCLUDED
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <type_safe/reference.hpp>
@@ -44,6 +45,13 @@ namespace standardese
         void register_entity(std::string link_name, const cppast::cpp_entity& entity,
                              type_safe::optional_ref<const markup::brief_section> brief) const;
 
+        /// \effects Registers an entity given its name and scope,
+        /// the names of its parent namespaces each followed by `::`.
+        /// Duplicate registration has no effect.
+        /// \notes This function is thread safe.
+        void register_entity(std::string link_name, std::string name, std::string scope,
+                             type_safe::optional_ref<const markup::brief_section> brief) const;
+
         /// \effects Registers a namespace and its (incomplete) documentation.
         /// The user data of the namespace must be `nullptr` or the corresponding [standardese::doc_entity].
         /// Duplicate registration will merge documentation.
@@ -51,6 +59,12 @@ namespace standardese
         void register_namespace(const cppast::cpp_namespace&             ns,
                                 markup::namespace_documentation::builder doc) const;
 
+        /// \effects Registers a namespace given its name, scope and (incomplete) documentation.
+        /// Duplicate registration will merge documentation.
+        /// \notes This function is thread safe.
+        void register_namespace(std::string name, std::string scope,
+                                markup::namespace_documentation::builder doc) const;
+
         /// How the entities are ordered.
         enum order
         {
@@ -143,6 +157,13 @@ namespace standardese
                              const cppast::cpp_entity&                            entity,
                              type_safe::optional_ref<const markup::brief_section> brief) const;
 
+        /// \effects Registers an entity given its name for the given module.
+        /// \returns Whether or not there was a module already.
+        /// If `false`, this function had no effect.
+        /// \notes This function is thread safe.
+        bool register_entity(std::string module, std::string link_name, const std::string& name,
+                             type_safe::optional_ref<const markup::brief_section> brief) const;
+
         /// \returns The markup containing the index of all modules registered so far.
         /// \requires This function must only be called once.
         /// \notes This function is thread safe.
@@ -158,6 +179,58 @@ namespace standardese
     /// Registers all entities in a module for the corresponding module.
     void register_module_entities(const module_index& index, const comment_registry& registry,
                                   const cppast::cpp_file& file);
+
+    class doc_cpp_file;
+
+    /// The entries a file contributes to the entity, file and module index.
+    ///
+    /// Unlike the file they don't refer to any [cppast::cpp_entity](),
+    /// so they can be kept after the file was destroyed.
+    struct index_entries
+    {
+        /// An entity of the entity or file index.
+        struct entity_entry
+        {
+            std::string                            link_name;
+            std::string                            name;
+            std::string                            scope; //< empty for a file
+            std::unique_ptr<markup::brief_section> brief; //< may be `nullptr`
+        };
+
+        /// A namespace of the entity index.
+        struct namespace_entry
+        {
+            std::string                                      name;
+            std::string                                      scope;
+            std::unique_ptr<markup::namespace_documentation> doc; //< without children
+        };
+
+        /// An entity of the module index.
+        struct module_entry
+        {
+            std::string                            module;
+            std::string                            link_name;
+            std::string                            name;
+            std::unique_ptr<markup::brief_section> brief; //< may be `nullptr`
+        };
+
+        std::vector<entity_entry>                                  entities;
+        std::vector<namespace_entry>                               namespaces;
+        std::vector<std::unique_ptr<markup::module_documentation>> modules; //< without children
+        std::vector<module_entry>                                  module_entities;
+        entity_entry                                               file;
+    };
+
+    /// \returns The entries of the file,
+    /// registering them is the same as registering the file itself
+    /// using [standardese::register_index_entities](), [standardese::register_module_entities]()
+    /// and [standardese::file_index::register_file]().
+    index_entries get_index_entries(const comment_registry& registry, const doc_cpp_file& file);
+
+    /// \effects Registers the entries in the indices.
+    /// \notes This function is thread safe.
+    void register_index_entries(const entity_index& eindex, const file_index& findex,
+                                const module_index& mindex, const index_entries& entries);
 } // namespace standardese
 
 #endif // STANDARDESE_INDEX_HPP_INCLUDED
@@ -9,6 +9,7 @@
 #include <mutex>
 #include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 #include <type_safe/variant.hpp>
 
@@ -44,12 +45,28 @@ namespace standardese
                                     const markup::block_id& documentation,
                                     bool                    force = false) const;
 
+        /// \effects Same as above, but takes a reference to the documentation directly.
+        /// This allows registering documentation of documents that aren't available,
+        /// e.g. because they have been generated by a previous run.
+        /// \requires The reference must specify a document.
+        /// \notes This function is thread safe.
+        bool register_documentation(std::string link_name, markup::block_reference documentation,
+                                    bool force = false) const;
+
         /// \returns A reference to the documentation for the given linke name, if there is any.
         /// \notes This function is thread safe.
         type_safe::variant<type_safe::nullvar_t, markup::block_reference, markup::url>
             lookup_documentation(type_safe::optional_ref<const cppast::cpp_entity> context,
                                  std::string                                       link_name) const;
 
+        /// \returns The same as above,
+        /// but relative link names are looked up in the given scopes, innermost first.
+        /// A scope is a sequence of names each followed by `::`, e.g. `a::b::`.
+        /// \notes This function is thread safe.
+        type_safe::variant<type_safe::nullvar_t, markup::block_reference, markup::url>
+            lookup_documentation(const std::vector<std::string>& scopes,
+                                 std::string                     link_name) const;
+
     private:
         mutable std::mutex                                               mutex_;
         mutable std::unordered_map<std::string, markup::block_reference> map_;
@@ -64,10 +81,39 @@ namespace standardese
     void register_documentations(const cppast::diagnostic_logger& logger, const linker& l,
                                  const markup::document_entity& document);
 
+    /// Registers all documentations in the documents of a file and its pages.
+    /// \effects The same as registering each document on its own,
+    /// but the entities whose documentation is on a page are registered for the document of the page.
+    /// A page is a document whose children are entity documentations,
+    /// as created from the pages of [standardese::generate_documentation]().
+    /// \requires The pages must be passed together with the document of their file.
+    /// \notes This function is thread safe.
+    void register_documentations(const cppast::diagnostic_logger& logger, const linker& l,
+                                 const std::vector<const markup::document_entity*>& documents);
+
+    /// A registration of a link name performed by [standardese::register_documentations]().
+    struct documentation_registration
+    {
+        std::string      link_name;
+        markup::block_id id;
+        bool             force;
+    };
+
+    /// \returns All registrations [standardese::register_documentations]() would perform for the document,
+    /// in the same order.
+    std::vector<documentation_registration> get_documentation_registrations(
+        const markup::document_entity& document);
+
+    /// \returns All registrations [standardese::register_documentations]() would perform for the documents,
+    /// one vector per document in the same order.
+    std::vector<std::vector<documentation_registration>> get_documentation_registrations(
+        const std::vector<const markup::document_entity*>& documents);
+
     /// Resolves all unresolved links in a document.
     /// \effects For all [standardese::markup::documentation_link]() entities that are not yet resolved,
     /// uses the linker to resolve them.
-    /// \notes This function is *not* thread safe and must be called after the linker is entirely populated.
+    /// \notes This function must be called after the linker is entirely populated.
+    /// It is thread safe as long as each document is only resolved by one thread at a time.
     void resolve_links(const cppast::diagnostic_logger& logger, const linker& l,
                        const markup::document_entity& document);
 } // namespace standardese
@@ -121,12 +121,23 @@ namespace standardese
             class builder : public documentation_builder<container_builder<namespace_documentation>>
             {
             public:
-                /// \effects Creates it giving the id and header.
-                /// \requires The user data of the namespace must either be `nullptr` or the corresponding [standardese::doc_entity]().
+                /// \effects Creates it giving the namespace, id and header.
                 builder(type_safe::object_ref<const cppast::cpp_namespace> ns, block_id id,
                         type_safe::optional<documentation_header> h)
+                : builder(get_scope(*ns), std::move(id), std::move(h))
+                {
+                }
+
+                /// \effects Creates it giving the scope of the namespace, id and header.
+                builder(std::string scope, block_id id, type_safe::optional<documentation_header> h)
                 : documentation_builder(std::unique_ptr<namespace_documentation>(
-                      new namespace_documentation(ns, std::move(id), std::move(h))))
+                      new namespace_documentation(std::move(scope), std::move(id), std::move(h))))
+                {
+                }
+
+                /// \effects Creates it giving a documentation that already has sections.
+                explicit builder(std::unique_ptr<namespace_documentation> doc)
+                : documentation_builder(std::move(doc))
                 {
                 }
 
@@ -144,27 +155,35 @@ namespace standardese
 
             private:
                 using container_builder::add_child;
+
+                friend class namespace_documentation;
             };
 
-            const cppast::cpp_namespace& namespace_() const noexcept
+            /// \returns The scope the namespace is declared in,
+            /// the names of its parent namespaces each followed by `::`.
+            /// \notes The documentation doesn't refer to the namespace itself,
+            /// so it can be used after the namespace was destroyed.
+            const std::string& scope() const noexcept
             {
-                return *ns_;
+                return scope_;
             }
 
         private:
-            namespace_documentation(type_safe::object_ref<const cppast::cpp_namespace> ns,
-                                    block_id id, type_safe::optional<documentation_header> h)
-            : documentation_entity(std::move(id), std::move(h), nullptr), ns_(ns)
+            namespace_documentation(std::string scope, block_id id,
+                                    type_safe::optional<documentation_header> h)
+            : documentation_entity(std::move(id), std::move(h), nullptr), scope_(std::move(scope))
             {
             }
 
+            static std::string get_scope(const cppast::cpp_namespace& ns);
+
             entity_kind do_get_kind() const noexcept override;
 
             void do_visit(detail::visitor_callback_t cb, void* mem) const override;
 
             std::unique_ptr<entity> do_clone() const override;
 
-            type_safe::object_ref<const cppast::cpp_namespace> ns_;
+            std::string scope_;
         };
 
         /// The index of all entities.
@@ -228,6 +247,12 @@ namespace standardese
                       new module_documentation(std::move(id), std::move(h), nullptr)))
                 {
                 }
+
+                /// \effects Creates it giving a documentation that already has sections.
+                explicit builder(std::unique_ptr<module_documentation> doc)
+                : documentation_builder(std::move(doc))
+                {
+                }
             };
 
         private:
@@ -9,6 +9,8 @@
 #include <cppast/visitor.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <functional>
 
 #include "get_special_entity.hpp"
 
@@ -16,10 +18,25 @@ using namespace standardese;
 
 void comment_registry::merge(comment_registry&& other)
 {
-    map_.insert(std::make_move_iterator(other.map_.begin()),
-                std::make_move_iterator(other.map_.end()));
-    groups_.insert(std::make_move_iterator(other.groups_.begin()),
-                   std::make_move_iterator(other.groups_.end()));
+    if (comments_.empty())
+    {
+        // moving the deque keeps the addresses of the comments
+        comments_ = std::move(other.comments_);
+        slots_    = std::move(other.slots_);
+    }
+    else
+    {
+        rehash(comments_.size() + other.comments_.size());
+        for (auto& s : other.slots_)
+            if (s.entity && !slots_[find_slot(s.entity)].entity)
+                insert(s.entity, std::move(other.comments_[s.index]));
+    }
+
+    for (auto& group : other.groups_)
+    {
+        auto& members = groups_[group.first];
+        members.insert(members.end(), group.second.begin(), group.second.end());
+    }
     modules_.insert(std::make_move_iterator(other.modules_.begin()),
                     std::make_move_iterator(other.modules_.end()));
 }
@@ -27,13 +44,12 @@ void comment_registry::merge(comment_registry&& other)
 bool comment_registry::register_comment(type_safe::object_ref<const cppast::cpp_entity> entity,
                                         comment::doc_comment                            comment)
 {
-    auto iter = map_.find(&*entity);
-    if (iter == map_.end())
+    if (slots_.empty() || !slots_[find_slot(&*entity)].entity)
         // not in map yet
-        map_.emplace(&*entity, std::move(comment));
+        insert(&*entity, std::move(comment));
     else
     {
-        auto& stored_comment = iter->second;
+        auto& stored_comment = comments_[slots_[find_slot(&*entity)].index];
         if (stored_comment.brief_section() || !stored_comment.sections().empty())
             // already have a documentation
             return false;
@@ -59,10 +75,13 @@ type_safe::optional_ref<const comment::doc_comment> comment_registry::get_commen
     if (cppast::is_templated(*entity))
         entity = &entity->parent().value();
 
-    auto iter = map_.find(entity);
-    if (iter == map_.end())
+    if (slots_.empty())
         return type_safe::nullopt;
-    return type_safe::ref(iter->second);
+
+    auto& s = slots_[find_slot(entity)];
+    if (!s.entity)
+        return type_safe::nullopt;
+    return type_safe::ref(comments_[s.index]);
 }
 
 type_safe::optional_ref<const comment::doc_comment> comment_registry::get_comment(
@@ -74,6 +93,46 @@ type_safe::optional_ref<const comment::doc_comment> comment_registry::get_commen
     return type_safe::ref(iter->second);
 }
 
+std::size_t comment_registry::find_slot(const cppast::cpp_entity* entity) const noexcept
+{
+    assert(!slots_.empty());
+
+    // Fibonacci hashing, the low bits of the pointer are always zero due to alignment
+    auto hash  = std::uint64_t(reinterpret_cast<std::uintptr_t>(entity)) * 11400714819323198485ull;
+    auto mask  = slots_.size() - 1u;
+    auto index = std::size_t(hash >> 32u) & mask;
+    while (slots_[index].entity && slots_[index].entity != entity)
+        index = (index + 1u) & mask;
+    return index;
+}
+
+void comment_registry::insert(const cppast::cpp_entity* entity, comment::doc_comment comment)
+{
+    // keep the load factor at most one half
+    if (2u * (comments_.size() + 1u) > slots_.size())
+        rehash(comments_.size() + 1u);
+
+    auto& s = slots_[find_slot(entity)];
+    assert(!s.entity);
+    s = slot{entity, comments_.size()};
+    comments_.push_back(std::move(comment));
+}
+
+void comment_registry::rehash(std::size_t no_comments)
+{
+    auto no_slots = std::max(slots_.size(), std::size_t(16u));
+    while (no_slots < 2u * no_comments)
+        no_slots *= 2u;
+    if (no_slots == slots_.size())
+        return;
+
+    auto old = std::move(slots_);
+    slots_.assign(no_slots, slot{nullptr, 0u});
+    for (auto& s : old)
+        if (s.entity)
+            slots_[find_slot(s.entity)] = s;
+}
+
 namespace
 {
     cppast::source_location make_location(const cppast::cpp_entity&   entity,
@@ -174,7 +233,10 @@ namespace
 
 void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> file) const
 {
-    comment::parser p(config_);
+    auto& p = comment::get_thread_parser(config_);
+    shard s;
+    // the parents belong to the same file, so their comments are in the shard
+    unique_name_table names(s.registry);
 
     // add matched comments
     cppast::visit(*file, [&](const cppast::cpp_entity& entity, const cppast::visitor_info& info) {
@@ -185,10 +247,10 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
         {
             auto register_commented = [&](type_safe::object_ref<const cppast::cpp_entity> e,
                                           comment::doc_comment                            comment) {
-                this->register_commented(e, std::move(comment));
+                file_comment_parser::register_commented(s, names, e, std::move(comment));
             };
             auto register_uncommented = [&](type_safe::object_ref<const cppast::cpp_entity> e) {
-                this->register_uncommented(e);
+                file_comment_parser::register_uncommented(s, names, e);
             };
 
             // parse comment
@@ -196,7 +258,7 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
             try
             {
                 comment = type_safe::copy(entity.comment()).map([&](const std::string& str) {
-                    return comment::parse(p, str, true);
+                    return parse_cached(p, str);
                 });
             }
             catch (comment::parse_error& ex)
@@ -236,7 +298,7 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
         if (comment::is_file(comment.entity))
         {
             // comment for current file
-            if (!register_commented(file, std::move(comment.comment.value())))
+            if (!register_commented(s, names, file, std::move(comment.comment.value())))
                 logger_->log("standardese comment",
                              make_semantic_diagnostic(*file, "multiple file comments"));
         }
@@ -244,7 +306,7 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
         {
             std::unique_lock<std::mutex> lock(mutex_);
             auto                         result =
-                registry_.register_comment(module.value(), std::move(comment.comment.value()));
+                modules_.register_comment(module.value(), std::move(comment.comment.value()));
             lock.unlock();
 
             if (!result)
@@ -257,7 +319,7 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
         else if (auto name = comment::get_remote_entity(comment.entity))
         {
             assert(comment.comment);
-            free_comments_.push_back(std::move(comment));
+            s.free_comments.push_back(std::move(comment));
         }
         else
             logger_
@@ -265,26 +327,103 @@ void file_comment_parser::parse(type_safe::object_ref<const cppast::cpp_file> fi
                       make_diagnostic(cppast::source_location::make_file(file->name(), free.line),
                                       "unmatched comment doesn't have a remote entity specified"));
     }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    shards_.push_back(std::move(s));
+}
+
+namespace
+{
+    // rough numbers, the markup of a comment is a tree of small allocations
+    constexpr std::uint64_t seen_memory = 4u * sizeof(std::size_t);
+
+    std::uint64_t get_cache_memory(const std::string& text)
+    {
+        return 256u + 8u * text.size();
+    }
+} // namespace
+
+comment::parse_result file_comment_parser::parse_cached(const comment::parser& p,
+                                                        const std::string&     text) const
+{
+    auto hash = std::hash<std::string>()(text);
+
+    const comment::parse_result* cached = nullptr;
+    auto                         keep   = false;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto                        iter = cache_.find(text);
+        if (iter != cache_.end())
+            cached = &iter->second;
+        else if (seen_.count(hash) != 0u)
+            // parsed for the second time, so it is likely repeated again
+            keep = true;
+        else if (cache_memory_ + seen_memory <= cache_limit_)
+        {
+            seen_.insert(hash);
+            cache_memory_ += seen_memory;
+        }
+    }
+
+    if (cached)
+    {
+        // cached results are never modified or erased while parsing, so no lock is needed
+        ++cache_hits_;
+        return comment::clone(*cached);
+    }
+
+    ++cache_misses_;
+    auto result = comment::parse(p, text, true);
+    if (keep)
+    {
+        auto memory = get_cache_memory(text);
+        auto copy   = comment::clone(result);
+
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        // does nothing if another thread parsed the same text in the meantime
+        if (cache_memory_ + memory <= cache_limit_
+            && cache_.emplace(text, std::move(copy)).second)
+            cache_memory_ += memory;
+    }
+    return result;
 }
 
 comment_registry file_comment_parser::finish()
 {
+    seen_.clear();
+    cache_.clear();
+    cache_memory_ = 0u;
+
+    shard all;
+    all.registry = std::move(modules_);
+    for (auto& s : shards_)
+    {
+        all.registry.merge(std::move(s.registry));
+        all.uncommented.insert(std::make_move_iterator(s.uncommented.begin()),
+                               std::make_move_iterator(s.uncommented.end()));
+        all.free_comments.insert(all.free_comments.end(),
+                                 std::make_move_iterator(s.free_comments.begin()),
+                                 std::make_move_iterator(s.free_comments.end()));
+    }
+    shards_.clear();
+    unique_name_table names(all.registry);
+
     // find suitable entities for the free comments
-    for (auto& free : free_comments_)
+    for (auto& free : all.free_comments)
     {
-        auto result = uncommented_.equal_range(comment::get_remote_entity(free.entity).value());
+        auto result = all.uncommented.equal_range(comment::get_remote_entity(free.entity).value());
         if (result.first != result.second)
         {
             auto metadata = free.comment.value().metadata();
 
-            register_commented(type_safe::ref(*result.first->second),
+            register_commented(all, names, type_safe::ref(*result.first->second),
                                std::move(free.comment.value()), false);
 
             for (auto cur = std::next(result.first); cur != result.second; ++cur)
-                register_commented(type_safe::ref(*cur->second),
+                register_commented(all, names, type_safe::ref(*cur->second),
                                    comment::doc_comment(metadata, nullptr, {}), false);
 
-            uncommented_.erase(result.first, result.second);
+            all.uncommented.erase(result.first, result.second);
         }
         else
             logger_->log("standardese comment",
@@ -294,22 +433,22 @@ comment_registry file_comment_parser::finish()
                                          "' for comment"));
     }
 
-    return std::move(registry_);
+    return std::move(all.registry);
 }
 
-bool file_comment_parser::register_commented(type_safe::object_ref<const cppast::cpp_entity> entity,
-                                             comment::doc_comment comment, bool allow_cmd) const
+bool file_comment_parser::register_commented(shard& s, unique_name_table& names,
+                                             type_safe::object_ref<const cppast::cpp_entity> entity,
+                                             comment::doc_comment comment, bool allow_cmd)
 {
     auto cmd_comment = !comment.brief_section() && comment.sections().empty();
 
-    std::lock_guard<std::mutex> lock(mutex_);
     if (comment.metadata().group())
-        registry_.add_to_group(comment.metadata().group().value().name(), entity);
-    auto result = registry_.register_comment(entity, std::move(comment));
+        s.registry.add_to_group(comment.metadata().group().value().name(), entity);
+    auto result = s.registry.register_comment(entity, std::move(comment));
 
     if (cmd_comment && allow_cmd)
         // a pure "command" comment, allow later sections
-        uncommented_.emplace(lookup_unique_name(registry_, *entity), &*entity);
+        s.uncommented.emplace(names.lookup(*entity), &*entity);
 
     return result;
 }
@@ -427,76 +566,111 @@ namespace
         return result;
     }
 
-    template <class Lookup>
-    std::string lookup_parent_unique_name(const Lookup& get_comment, const cppast::cpp_entity& e)
+    // the parent the unique name of the entity is based on
+    type_safe::optional_ref<const cppast::cpp_entity> get_named_parent(const cppast::cpp_entity& e)
     {
         auto parent = e.parent();
         while (parent
                && (cppast::is_templated(parent.value()) || cppast::is_friended(parent.value())))
             parent = parent.value().parent();
-        if (!parent)
-            return "";
+        return parent;
+    }
 
+    // the unique name of the parent as used for the unique names of its children,
+    // get_parent_name() returns the one of its own parent
+    template <typename ParentName>
+    std::string make_parent_unique_name(const comment_registry&   registry,
+                                        const cppast::cpp_entity& parent,
+                                        const ParentName&         get_parent_name)
+    {
         // don't need unique name for parents that don't have a scope
         // except for functions or templates, those are fine
-        auto need_name = parent.value().scope_name() || detail::get_function(parent.value())
-                         || detail::get_template(parent.value());
+        auto need_name = parent.scope_name() || detail::get_function(parent)
+                         || detail::get_template(parent);
         if (!need_name)
             return "";
 
-        auto result =
-            parent
-                .map([&](const cppast::cpp_entity& p) {
-                    return p.scope_name() || detail::get_function(p) ? get_comment(p) :
-                                                                       type_safe::nullopt;
-                })
-                .map([](const comment::doc_comment& c) { return c.metadata().unique_name(); });
-        if (result)
-            return result.value();
+        if (parent.scope_name() || detail::get_function(parent))
+        {
+            auto comment = registry.get_comment(parent);
+            if (comment && comment.value().metadata().unique_name())
+                return comment.value().metadata().unique_name().value();
+        }
 
         // parent doesn't have a unique name
-        return get_full_unique_name(lookup_parent_unique_name(get_comment, parent.value()),
-                                    parent.value(), get_unique_name(parent.value()));
+        return get_full_unique_name(get_parent_name(), parent, get_unique_name(parent));
     }
-}
 
-void file_comment_parser::register_uncommented(
-    type_safe::object_ref<const cppast::cpp_entity> entity) const
-{
-    auto unique_name =
-        get_full_unique_name(get_parent_unique_name(*entity), *entity, get_unique_name(*entity));
+    // get_parent_name() returns the unique name of the parent as used for its children
+    template <typename ParentName>
+    std::string make_unique_name(const comment_registry& registry, const cppast::cpp_entity& e,
+                                 const ParentName& get_parent_name)
+    {
+        auto comment = registry.get_comment(e);
+        if (comment && comment.value().metadata().unique_name())
+        {
+            auto& unique_name = comment.value().metadata().unique_name().value();
+            if (is_relative_unique_name(unique_name))
+                return get_full_unique_name(get_parent_name(), e, unique_name.substr(1));
+            else
+                return unique_name;
+        }
 
-    std::lock_guard<std::mutex> lock(mutex_);
-    uncommented_.emplace(std::move(unique_name), &*entity);
+        // calculate unique name
+        return get_full_unique_name(get_parent_name(), e, get_unique_name(e));
+    }
+
+    std::string lookup_parent_unique_name(const comment_registry&   registry,
+                                          const cppast::cpp_entity& e)
+    {
+        auto parent = get_named_parent(e);
+        if (!parent)
+            return "";
+        return make_parent_unique_name(registry, parent.value(), [&] {
+            return lookup_parent_unique_name(registry, parent.value());
+        });
+    }
 }
 
-std::string file_comment_parser::get_parent_unique_name(const cppast::cpp_entity& e) const
+void file_comment_parser::register_uncommented(
+    shard& s, unique_name_table& names, type_safe::object_ref<const cppast::cpp_entity> entity)
 {
-    return lookup_parent_unique_name([&](const cppast::cpp_entity& e) { return get_comment(e); },
-                                     e);
+    s.uncommented.emplace(names.lookup(*entity), &*entity);
 }
 
 std::string standardese::lookup_unique_name(const comment_registry&   registry,
                                             const cppast::cpp_entity& e)
 {
-    auto comment = registry.get_comment(e);
-    if (comment && comment.value().metadata().unique_name())
+    return make_unique_name(registry, e, [&] { return lookup_parent_unique_name(registry, e); });
+}
+
+const std::string& unique_name_table::lookup(const cppast::cpp_entity& e)
+{
+    auto iter = names_.find(&e);
+    if (iter == names_.end())
     {
-        if (is_relative_unique_name(comment.value().metadata().unique_name().value()))
-        {
-            auto parent = lookup_parent_unique_name([&](const cppast::cpp_entity&
-                                                            e) { return registry.get_comment(e); },
-                                                    e);
-            return get_full_unique_name(parent, e,
-                                        comment.value().metadata().unique_name().value().substr(1));
-        }
-        else
-            return comment.value().metadata().unique_name().value();
+        auto name = make_unique_name(*registry_, e,
+                                     [&]() -> const std::string& { return lookup_parent(e); });
+        iter = names_.emplace(&e, std::move(name)).first;
     }
+    return iter->second;
+}
+
+const std::string& unique_name_table::lookup_parent(const cppast::cpp_entity& e)
+{
+    auto parent = get_named_parent(e);
+    auto key    = parent ? &parent.value() : nullptr;
 
-    // calculate unique name
-    auto parent = lookup_parent_unique_name([&](const cppast::cpp_entity&
-                                                    e) { return registry.get_comment(e); },
-                                            e);
-    return get_full_unique_name(parent, e, get_unique_name(e));
+    auto iter = parent_names_.find(key);
+    if (iter == parent_names_.end())
+    {
+        std::string name;
+        if (parent)
+            name = make_parent_unique_name(*registry_, parent.value(),
+                                           [&]() -> const std::string& {
+                                               return lookup_parent(parent.value());
+                                           });
+        iter = parent_names_.emplace(key, std::move(name)).first;
+    }
+    return iter->second;
 }
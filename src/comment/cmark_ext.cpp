@@ -123,11 +123,42 @@ namespace
         cmark_node_set_string_content(node, arg);
     }
 
+    // a range of characters in the line the parser is currently processing
+    struct input_view
+    {
+        const char* begin;
+        std::size_t length;
+
+        input_view() noexcept : begin(nullptr), length(0u) {}
+
+        input_view(const char* begin, std::size_t length) noexcept : begin(begin), length(length)
+        {
+        }
+
+        bool empty() const noexcept
+        {
+            return length == 0u;
+        }
+    };
+
     cmark_node* make_node(cmark_syntax_extension* self, cmark_parser* parser, cmark_node* parent,
-                          int indent, cmark_node_type node_type, unsigned raw_cmd, const char* arg)
+                          int indent, cmark_node_type node_type, unsigned raw_cmd,
+                          input_view arg)
     {
         auto node = cmark_parser_add_child(parser, parent, node_type, indent);
-        init_node(self, node, raw_cmd, arg);
+        if (arg.empty())
+            init_node(self, node, raw_cmd, arg.begin ? "" : nullptr);
+        else if (arg.length < 64u)
+        {
+            // cmark copies a null-terminated string and the line belongs to the parser,
+            // so terminate a copy on the stack, most arguments are short
+            char buffer[64];
+            std::memcpy(buffer, arg.begin, arg.length);
+            buffer[arg.length] = '\0';
+            init_node(self, node, raw_cmd, buffer);
+        }
+        else
+            init_node(self, node, raw_cmd, std::string(arg.begin, arg.length).c_str());
         return node;
     }
 
@@ -158,18 +189,28 @@ namespace
             ++cur;
     }
 
-    std::string parse_word(char*& cur)
+    std::size_t get_word_length(const char* cur)
+    {
+        auto end = cur;
+        while (*end && !is_special_char(*end) && !is_whitespace(*end) && *end != '-')
+            ++end;
+        return std::size_t(end - cur);
+    }
+
+    input_view parse_word(char*& cur)
     {
         auto save = cur;
         skip_whitespace(cur);
 
-        std::string word;
-        for (; *cur && !is_special_char(*cur) && !is_whitespace(*cur) && *cur != '-'; ++cur)
-            word += *cur;
-
-        if (word.empty())
+        auto length = get_word_length(cur);
+        if (length == 0u)
+        {
             cur = save;
+            return input_view();
+        }
 
+        input_view word(cur, length);
+        cur += length;
         return word;
     }
 
@@ -179,23 +220,31 @@ namespace
         {
             ++cur;
 
-            auto command = parse_word(cur);
-            if (command.empty())
+            // look it up in place, this is called for every command
+            auto save = cur;
+            skip_whitespace(cur);
+            auto length = get_word_length(cur);
+            if (length == 0u)
+            {
                 // if command character was backslash, it was probably used to escape something
+                cur = save;
                 return type_safe::nullopt;
-            else
-                return c.try_lookup(command.c_str());
+            }
+
+            auto command = c.try_lookup(cur, length);
+            cur += length;
+            return command;
         }
         else
             return type_safe::nullopt;
     }
 
-    type_safe::optional<std::string> parse_section_key(char*& cur)
+    input_view parse_section_key(char*& cur)
     {
         auto save       = cur;
         auto first_word = parse_word(cur);
         if (first_word.empty())
-            return type_safe::nullopt;
+            return input_view();
 
         skip_whitespace(cur);
         if (*cur == '-')
@@ -210,18 +259,19 @@ namespace
             // don't have a key
             cur = save;
 
-        return type_safe::nullopt;
+        return input_view();
     }
 
-    std::string parse_command_args(char*& cur)
+    input_view parse_command_args(char*& cur)
     {
         skip_whitespace(cur);
 
-        std::string result;
+        auto begin = cur;
         while (*cur && *cur != '\n')
-            result += *cur++;
+            ++cur;
 
-        return result;
+        // begin isn't null, so no arguments are an empty string
+        return input_view(begin, std::size_t(cur - begin));
     }
 
     cmark_node* parse_node(cmark_syntax_extension* self, char*& cur, cmark_parser* parser,
@@ -241,27 +291,26 @@ namespace
         {
             auto key = parse_section_key(cur);
             return make_node(self, parser, parent, indent, node_section_tmp(), command.value(),
-                             key.map([](const std::string& str) { return str.c_str(); })
-                                 .value_or(nullptr));
+                             key);
         }
         else if (is_inline(command.value()))
         {
             auto entity = parse_word(cur);
             return make_node(self, parser, parent, indent, node_inline_tmp(), command.value(),
-                             entity.empty() ? nullptr : entity.c_str());
+                             entity);
         }
         else if (is_command(command.value()))
         {
             auto args = parse_command_args(cur);
-            return make_node(self, parser, parent, indent, node_command(), command.value(),
-                             args.c_str());
+            return make_node(self, parser, parent, indent, node_command(), command.value(), args);
         }
         else
         {
             // add invalid command node
             // this will trigger a warning
             return make_node(self, parser, parent, indent, node_command(),
-                             unsigned(command_type::invalid), std::string(save, cur).c_str());
+                             unsigned(command_type::invalid),
+                             input_view(save, std::size_t(cur - save)));
         }
     }
 
@@ -4,6 +4,9 @@
 
 #include <standardese/comment/config.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace standardese::comment;
 
 const char* config::default_command_name(command_type cmd) noexcept
@@ -220,21 +223,26 @@ config::config(char command_character) : command_character_(command_character)
 
     for (auto i = 0u; i != unsigned(section_type::count); ++i)
         list_sections_[i] = default_list_section_name(make_section(i));
+
+    build_trie();
 }
 
 void config::set_command_name(command_type cmd, std::string name)
 {
     command_names_[unsigned(cmd)] = std::move(name);
+    build_trie();
 }
 
 void config::set_command_name(section_type cmd, std::string name)
 {
     command_names_[unsigned(cmd)] = std::move(name);
+    build_trie();
 }
 
 void config::set_command_name(inline_type cmd, std::string name)
 {
     command_names_[unsigned(cmd)] = std::move(name);
+    build_trie();
 }
 
 const char* config::command_name(command_type cmd) const noexcept
@@ -254,15 +262,23 @@ const char* config::command_name(inline_type cmd) const noexcept
 
 unsigned config::try_lookup(const char* name) const noexcept
 {
-    auto i = 0u;
-    for (auto& el : command_names_)
+    return try_lookup(name, std::strlen(name));
+}
+
+unsigned config::try_lookup(const char* name, std::size_t length) const noexcept
+{
+    auto node = 0u;
+    for (auto cur = name; cur != name + length; ++cur)
     {
-        if (el == name)
-            return i;
-        ++i;
+        auto child = trie_[node].first_child;
+        while (child != trie_[node].last_child && trie_[child].c != *cur)
+            ++child;
+        if (child == trie_[node].last_child)
+            return unsigned(command_type::invalid);
+        node = child;
     }
 
-    return unsigned(command_type::invalid);
+    return trie_[node].command;
 }
 
 const char* config::inline_section_name(section_type section) const noexcept
@@ -274,3 +290,52 @@ const char* config::list_section_name(section_type section) const noexcept
 {
     return list_sections_[unsigned(section)].c_str();
 }
+
+void config::build_trie()
+{
+    // sort the names, so that the names below a node form a range,
+    // and for duplicate names the first command comes first
+    std::vector<unsigned> order(command_names_.size());
+    for (auto i = 0u; i != order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        return command_names_[a] < command_names_[b];
+    });
+
+    // a node of the trie whose children haven't been added yet
+    struct pending_node
+    {
+        unsigned    node;
+        std::size_t begin, end; //< range of the names below it in order
+        std::size_t depth;
+    };
+
+    // add the nodes breadth-first, so that the children of a node are adjacent
+    trie_.assign(1u, trie_node{0u, 0u, unsigned(command_type::invalid), '\0'});
+    std::vector<pending_node> queue{{0u, 0u, order.size(), 0u}};
+    for (auto i = std::size_t(0); i != queue.size(); ++i)
+    {
+        auto cur   = queue[i];
+        auto begin = cur.begin;
+
+        // the name ending at the node is a prefix of the others, so it is first
+        if (begin != cur.end && command_names_[order[begin]].size() == cur.depth)
+            trie_[cur.node].command = order[begin];
+        while (begin != cur.end && command_names_[order[begin]].size() == cur.depth)
+            ++begin;
+
+        trie_[cur.node].first_child = unsigned(trie_.size());
+        while (begin != cur.end)
+        {
+            auto c   = command_names_[order[begin]][cur.depth];
+            auto end = begin;
+            while (end != cur.end && command_names_[order[end]][cur.depth] == c)
+                ++end;
+
+            queue.push_back({unsigned(trie_.size()), begin, end, cur.depth + 1u});
+            trie_.push_back({0u, 0u, unsigned(command_type::invalid), c});
+            begin = end;
+        }
+        trie_[cur.node].last_child = unsigned(trie_.size());
+    }
+}
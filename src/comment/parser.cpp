@@ -4,8 +4,10 @@
 
 #include <standardese/comment/parser.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <iterator>
 #include <type_traits>
 
 #include <cmark.h>
@@ -54,6 +56,28 @@ parser::~parser() noexcept
     cmark_parser_free(parser_);
 }
 
+const parser& comment::get_thread_parser(const comment::config& c)
+{
+    // the parsers of the thread, the most recently used one is at the end
+    // usually there is only one configuration, so keep only a few of them
+    constexpr auto max_parsers = 4u;
+
+    thread_local std::vector<std::unique_ptr<parser>> parsers;
+
+    auto iter = std::find_if(parsers.begin(), parsers.end(),
+                             [&](const std::unique_ptr<parser>& p) { return p->config() == c; });
+    if (iter == parsers.end())
+    {
+        if (parsers.size() == max_parsers)
+            parsers.erase(parsers.begin());
+        parsers.emplace_back(new parser(c));
+    }
+    else if (std::next(iter) != parsers.end())
+        std::rotate(iter, std::next(iter), parsers.end());
+
+    return *parsers.back();
+}
+
 namespace
 {
     class ast_root
@@ -482,11 +506,15 @@ namespace
 
     type_safe::optional<std::string> get_next_arg(const char*& args)
     {
-        std::string result;
+        auto begin = args;
         while (*args && *args != ' ' && *args != '\t')
-            result += *args++;
+            ++args;
+        auto end = args;
         skip_ws(args);
-        return result.empty() ? type_safe::nullopt : type_safe::make_optional(std::move(result));
+
+        if (begin == end)
+            return type_safe::nullopt;
+        return type_safe::make_optional(std::string(begin, end));
     }
 
     std::string get_next_required_arg(const char*& args, cmark_node* node, const char* command)
@@ -802,7 +830,50 @@ namespace
     }
 }
 
-parse_result comment::parse(const parser& p, const std::string& comment, bool has_matching_entity)
+parse_result comment::parse(const comment::config& c, const std::string& comment,
+                           bool has_matching_entity)
+{
+    return parse(get_thread_parser(c), comment, has_matching_entity);
+}
+
+bool comment::detail::is_plain_brief(const config& c, const std::string& comment) noexcept
+{
+    auto is_letter = [](char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); };
+    auto is_digit  = [](char ch) { return ch >= '0' && ch <= '9'; };
+    // punctuation that isn't markup, not even with smart punctuation
+    auto is_plain_punctuation = [](char ch) { return std::strchr(",.;:?!()/=%+", ch) != nullptr; };
+
+    // must start with a letter to rule out block syntax such as lists or indented code,
+    // and must not end with a space to rule out hard line breaks
+    if (comment.empty() || !is_letter(comment.front()) || comment.back() == ' ')
+        return false;
+
+    auto prev = '\0';
+    for (auto ch : comment)
+    {
+        if (ch == c.command_character() || ch == '\0')
+            return false;
+        else if (ch == ' ')
+        {
+            if (prev == ' ')
+                return false;
+        }
+        else if (ch == '.')
+        {
+            // could be an ellipsis
+            if (prev == '.')
+                return false;
+        }
+        else if (!is_letter(ch) && !is_digit(ch) && !is_plain_punctuation(ch))
+            return false;
+        prev = ch;
+    }
+
+    return true;
+}
+
+parse_result comment::detail::parse_cmark(const parser& p, const std::string& comment,
+                                          bool has_matching_entity)
 {
     auto root = read_ast(p, comment);
 
@@ -817,3 +888,29 @@ parse_result comment::parse(const parser& p, const std::string& comment, bool ha
         return parse_result{type_safe::nullopt, std::move(builder.entity),
                             std::move(builder.inlines)};
 }
+
+parse_result comment::parse(const parser& p, const std::string& comment, bool has_matching_entity)
+{
+    if (!detail::is_plain_brief(p.config(), comment))
+        return detail::parse_cmark(p, comment, has_matching_entity);
+
+    // most comments are a single sentence, so don't bother the CommonMark parser,
+    // the result is the same: an implicit brief section containing the text
+    markup::brief_section::builder brief;
+    brief.add_child(markup::text::build(comment));
+    return parse_result{doc_comment(metadata(), brief.finish(), {}), matching_entity(), {}};
+}
+
+parse_result comment::clone(const parse_result& result)
+{
+    type_safe::optional<doc_comment> comment;
+    if (result.comment)
+        comment = clone(result.comment.value());
+
+    std::vector<unmatched_doc_comment> inlines;
+    inlines.reserve(result.inlines.size());
+    for (auto& inl : result.inlines)
+        inlines.emplace_back(inl.entity, clone(inl.comment));
+
+    return parse_result{std::move(comment), result.entity, std::move(inlines)};
+}
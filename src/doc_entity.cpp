@@ -7,7 +7,10 @@
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <cstddef>
+#include <iterator>
 #include <stack>
+#include <unordered_map>
 
 #include <cppast/cpp_enum.hpp>
 #include <cppast/cpp_entity_kind.hpp>
@@ -62,6 +65,78 @@ namespace
     doc_excluded_entity parent_excluded_entity;
 }
 
+//=== allocation ===//
+namespace
+{
+    constexpr auto arena_block_size = 16 * 1024u;
+
+    // stored in front of every doc entity, to know whether it was allocated in an arena
+    struct alignas(std::max_align_t) allocation_header
+    {
+        bool in_arena;
+    };
+
+    void* init_header(void* memory, bool in_arena) noexcept
+    {
+        auto header = ::new (memory) allocation_header{in_arena};
+        return header + 1;
+    }
+} // namespace
+
+detail::doc_entity_arena::~doc_entity_arena() noexcept
+{
+    for (auto cur = finalizers_; cur; cur = cur->next)
+        cur->destroy(cur->object);
+}
+
+void* detail::doc_entity_arena::allocate(std::size_t size)
+{
+    constexpr auto alignment = alignof(std::max_align_t);
+    size                     = (size + alignment - 1u) / alignment * alignment;
+
+    if (size > arena_block_size)
+    {
+        // give big objects their own block, so the current one isn't wasted
+        blocks_.emplace_back(new char[size]);
+        return blocks_.back().get();
+    }
+    else if (std::size_t(end_ - cur_) < size)
+    {
+        blocks_.emplace_back(new char[arena_block_size]);
+        cur_ = blocks_.back().get();
+        end_ = cur_ + arena_block_size;
+    }
+
+    auto result = cur_;
+    cur_ += size;
+    return result;
+}
+
+void* doc_entity::operator new(std::size_t size)
+{
+    return init_header(::operator new(sizeof(allocation_header) + size), false);
+}
+
+void* doc_entity::operator new(std::size_t size, detail::doc_entity_arena& arena)
+{
+    return init_header(arena.allocate(sizeof(allocation_header) + size), true);
+}
+
+void doc_entity::operator delete(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+
+    auto header = static_cast<allocation_header*>(ptr) - 1;
+    if (!header->in_arena)
+        ::operator delete(header);
+}
+
+void doc_entity::operator delete(void*, detail::doc_entity_arena&) noexcept
+{
+    // freed together with the arena
+}
+
 bool doc_entity::is_excluded() const noexcept
 {
     auto result = this == &excluded_entity || this == &parent_excluded_entity;
@@ -85,6 +160,18 @@ namespace
         return static_cast<const doc_entity*>(entity.user_data());
     }
 
+    bool is_documented(const doc_entity& entity)
+    {
+        if (entity.kind() == doc_entity::cpp_file)
+            return true;
+        else if (entity.parent() && entity.parent().value().kind() == doc_entity::member_group)
+            return is_documented(entity.parent().value());
+        else
+            return entity.comment()
+                   && (entity.comment().value().brief_section()
+                       || !entity.comment().value().sections().empty());
+    }
+
     bool is_in_group(const doc_entity* e)
     {
         return e && e->kind() == doc_entity::cpp_entity
@@ -354,18 +441,6 @@ private:
             builder_.add_child(markup::code_block::identifier::build(identifier.c_str()));
     }
 
-    bool is_documented(const doc_entity& entity) const
-    {
-        if (entity.kind() == doc_entity::cpp_file)
-            return true;
-        else if (entity.parent() && entity.parent().value().kind() == doc_entity::member_group)
-            return is_documented(entity.parent().value());
-        else
-            return entity.comment()
-                   && (entity.comment().value().brief_section()
-                       || !entity.comment().value().sections().empty());
-    }
-
     bool write_link(const doc_entity& entity, cppast::string_view name)
     {
         if (is_documented(entity))
@@ -386,6 +461,27 @@ private:
         return true;
     }
 
+    // the same as above, but with the information from the reference table
+    bool write_link(type_safe::optional_ref<const synopsis_reference_table::reference> entity,
+                    cppast::string_view                                              name)
+    {
+        if (entity && entity.value().documented)
+        {
+            markup::documentation_link::builder link(entity.value().link_name);
+            link.add_child(markup::code_block::identifier::build(name.c_str()));
+            builder_.add_child(link.finish());
+        }
+        else if (entity && entity.value().excluded)
+        {
+            write_excluded();
+            return false;
+        }
+        else
+            write_identifier(name);
+
+        return true;
+    }
+
     void do_write_identifier(cppast::string_view identifier) override
     {
         update_indent();
@@ -414,7 +510,10 @@ private:
                 entity = ns[0u];
         }
 
-        if (entity && get_doc_entity(entity.value()))
+        if (entity && config_->references())
+            // the entity might belong to a file that was already destroyed
+            return write_link(config_->references().value().lookup(&entity.value()), name);
+        else if (entity && get_doc_entity(entity.value()))
             return write_link(*get_doc_entity(entity.value()), name);
         else
             write_identifier(name);
@@ -508,6 +607,47 @@ std::unique_ptr<markup::code_block> standardese::generate_synopsis(
     }
 }
 
+void synopsis_reference_table::register_file(const cppast::cpp_file& file)
+{
+    std::vector<std::pair<const cppast::cpp_entity*, reference>> references;
+    auto register_entity = [&](const cppast::cpp_entity& entity) {
+        if (auto doc_e = get_doc_entity(entity))
+            references.emplace_back(&entity, reference{doc_e->link_name(), is_documented(*doc_e),
+                                                       doc_e->is_excluded()});
+    };
+
+    cppast::visit(file, [&](const cppast::cpp_entity& entity, const cppast::visitor_info& info) {
+        if (info.is_old_entity())
+            return;
+
+        register_entity(entity);
+
+        // handle inline entities
+        if (auto func = detail::get_function(entity))
+            for (auto& param : func.value().parameters())
+                register_entity(param);
+        if (auto templ = detail::get_template(entity))
+            for (auto& param : templ.value().parameters())
+                register_entity(param);
+        if (auto c = detail::get_class(entity))
+            for (auto& base : c.value().bases())
+                register_entity(base);
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    references_.insert(std::make_move_iterator(references.begin()),
+                       std::make_move_iterator(references.end()));
+}
+
+type_safe::optional_ref<const synopsis_reference_table::reference> synopsis_reference_table::
+    lookup(const cppast::cpp_entity* entity) const
+{
+    auto iter = references_.find(entity);
+    if (iter == references_.end())
+        return nullptr;
+    return type_safe::ref(iter->second);
+}
+
 cppast::code_generator::generation_options doc_cpp_entity::do_get_generation_options(
     const synopsis_config&, bool is_main) const
 {
@@ -784,19 +924,170 @@ namespace
     }
 }
 
+namespace
+{
+    // calls the function with the index of each child and the child,
+    // and returns the results in order,
+    // the children are handled in parallel if there is an executor
+    template <typename Func>
+    std::vector<std::unique_ptr<markup::documentation_entity>> generate_children(
+        const generation_config& config, const doc_entity& parent, Func f)
+    {
+        std::vector<const doc_entity*> children;
+        for (auto& child : parent)
+            children.push_back(&child);
+
+        std::vector<std::unique_ptr<markup::documentation_entity>> result(children.size());
+        if (!config.executor() || children.size() < 2u)
+            for (std::size_t i = 0u; i != children.size(); ++i)
+                result[i] = f(i, *children[i]);
+        else
+        {
+            std::vector<std::function<void()>> tasks;
+            tasks.reserve(children.size());
+            for (std::size_t i = 0u; i != children.size(); ++i)
+                tasks.push_back([&, i] { result[i] = f(i, *children[i]); });
+            config.executor()(tasks);
+        }
+
+        return result;
+    }
+
+    // whether or not a child of a file or namespace gets its own page
+    bool has_own_page(const doc_entity& child)
+    {
+        if (child.kind() == doc_entity::cpp_namespace)
+            return true;
+        else if (child.kind() == doc_entity::cpp_entity)
+            return detail::get_class(static_cast<const doc_cpp_entity&>(child).entity())
+                .has_value();
+        else
+            return false;
+    }
+
+    type_safe::optional_ref<const std::string> get_output_section(const doc_entity& child)
+    {
+        if (child.comment() && child.comment().value().metadata().output_section())
+            return type_safe::ref(child.comment().value().metadata().output_section().value());
+        else
+            return type_safe::nullopt;
+    }
+
+    std::unique_ptr<markup::entity_documentation> as_entity_documentation(
+        std::unique_ptr<markup::documentation_entity> doc)
+    {
+        assert(doc->kind() == markup::entity_kind::entity_documentation);
+        return std::unique_ptr<markup::entity_documentation>(
+            static_cast<markup::entity_documentation*>(doc.release()));
+    }
+
+    // returns the documentation of the children that stays in the parent,
+    // if there are pages, the other documentation is moved to them together with the nested pages
+    std::vector<std::unique_ptr<markup::entity_documentation>> split_children(
+        const doc_entity& parent, std::vector<std::unique_ptr<markup::documentation_entity>> docs,
+        std::vector<std::vector<documentation_page>>&            nested_pages,
+        type_safe::optional_ref<std::vector<documentation_page>> pages)
+    {
+        std::vector<std::unique_ptr<markup::entity_documentation>> result;
+
+        // the output section entities are added to, and the index of its page once there is one
+        type_safe::optional_ref<const std::string> section;
+        type_safe::optional<std::size_t>           section_page;
+
+        auto add_page = [&](std::string title, std::unique_ptr<markup::entity_documentation> doc) {
+            auto name = doc->id().as_str();
+            pages.value().push_back(documentation_page{std::move(title), std::move(name), {}});
+            pages.value().back().documentations.push_back(std::move(doc));
+        };
+
+        auto i = 0u;
+        for (auto& child : parent)
+        {
+            auto doc = std::move(docs[i]);
+            auto j   = i++;
+
+            if (pages && has_own_page(child))
+            {
+                section = type_safe::nullopt;
+                if (doc)
+                    add_page(child.link_name(), as_entity_documentation(std::move(doc)));
+            }
+            else if (pages && get_output_section(child))
+            {
+                section      = get_output_section(child);
+                section_page = type_safe::nullopt;
+            }
+
+            if (doc && section && section_page)
+                pages.value()[section_page.value()].documentations.push_back(
+                    as_entity_documentation(std::move(doc)));
+            else if (doc && section)
+            {
+                section_page = pages.value().size();
+                add_page(section.value(), as_entity_documentation(std::move(doc)));
+            }
+            else if (doc)
+                result.push_back(as_entity_documentation(std::move(doc)));
+
+            if (pages)
+                for (auto& page : nested_pages[j])
+                    pages.value().push_back(std::move(page));
+        }
+
+        return result;
+    }
+
+    // a list linking to the pages of a file
+    std::unique_ptr<markup::list_section> get_page_summary(
+        const std::string& link_name, const std::vector<documentation_page>& pages)
+    {
+        markup::unordered_list::builder list(markup::block_id(link_name + "-pages"));
+        for (auto& page : pages)
+        {
+            auto& doc  = *page.documentations.front();
+            auto  link = markup::documentation_link::builder(page.name)
+                            .add_child(markup::text::build(page.title))
+                            .finish();
+
+            markup::description::builder description;
+            if (doc.brief_section())
+                for (auto& phrasing : doc.brief_section().value())
+                    description.add_child(markup::clone(phrasing));
+            else
+                description.add_child(markup::text::build(get_entity_kind_spelling(doc.entity())));
+
+            list.add_item(markup::term_description_item::build(markup::block_id(),
+                                                               markup::term::build(std::move(link)),
+                                                               description.finish()));
+        }
+
+        return markup::list_section::build(markup::section_type::invalid, "Pages", list.finish());
+    }
+}
+
 std::unique_ptr<markup::documentation_entity> standardese::generate_documentation(
     const generation_config& gen_config, const synopsis_config& syn_config,
     const cppast::cpp_entity_index& index, const doc_entity& entity)
 {
+    return entity.do_generate_documentation(gen_config, syn_config, index, nullptr, nullptr);
+}
+
+std::unique_ptr<markup::documentation_entity> standardese::generate_documentation(
+    const generation_config& gen_config, const synopsis_config& syn_config,
+    const cppast::cpp_entity_index& index, const doc_cpp_file& file,
+    std::vector<documentation_page>& pages)
+{
+    // the function is private in the file
+    auto& entity = static_cast<const doc_entity&>(file);
     return entity.do_generate_documentation(gen_config, syn_config, index, nullptr,
-                                            generate_synopsis(syn_config, index, entity));
+                                            type_safe::ref(pages));
 }
 
 std::unique_ptr<markup::documentation_entity> doc_cpp_entity::do_generate_documentation(
     const generation_config& gen_config, const synopsis_config& syn_config,
-    const cppast::cpp_entity_index&                     index,
-    type_safe::optional_ref<detail::inline_entity_list> inlines,
-    std::unique_ptr<markup::code_block>                 synopsis) const
+    const cppast::cpp_entity_index&                          index,
+    type_safe::optional_ref<detail::inline_entity_list>      inlines,
+    type_safe::optional_ref<std::vector<documentation_page>>) const
 {
     auto inline_doc =
         gen_config.is_flag_set(generation_config::inline_doc) && empty_sections(comment());
@@ -828,17 +1119,15 @@ std::unique_ptr<markup::documentation_entity> doc_cpp_entity::do_generate_docume
         markup::entity_documentation::builder builder(entity_, get_documentation_id(),
                                                       get_header(*entity_, comment(),
                                                                  get_entity_name(true, *entity_)),
-                                                      std::move(synopsis));
+                                                      generate_synopsis(syn_config, index, *this));
         if (comment())
             comment::set_sections(builder, comment().value());
 
         detail::inline_entity_list my_inlines(link_name());
         for (auto& child : *this)
         {
-            auto child_doc =
-                child.do_generate_documentation(gen_config, syn_config, index,
-                                                type_safe::ref(my_inlines),
-                                                generate_synopsis(syn_config, index, child));
+            auto child_doc = child.do_generate_documentation(gen_config, syn_config, index,
+                                                             type_safe::ref(my_inlines), nullptr);
             if (child_doc)
             {
                 assert(child_doc->kind() == markup::entity_kind::entity_documentation);
@@ -879,40 +1168,36 @@ std::unique_ptr<markup::documentation_entity> doc_cpp_entity::do_generate_docume
 
 std::unique_ptr<markup::documentation_entity> doc_metadata_entity::do_generate_documentation(
     const generation_config&, const synopsis_config&, const cppast::cpp_entity_index&,
-    type_safe::optional_ref<detail::inline_entity_list>, std::unique_ptr<markup::code_block>) const
+    type_safe::optional_ref<detail::inline_entity_list>,
+    type_safe::optional_ref<std::vector<documentation_page>>) const
 {
     return nullptr;
 }
 
 std::unique_ptr<markup::documentation_entity> doc_member_group_entity::do_generate_documentation(
     const generation_config& gen_config, const synopsis_config& syn_config,
-    const cppast::cpp_entity_index&                     index,
-    type_safe::optional_ref<detail::inline_entity_list> inlines,
-    std::unique_ptr<markup::code_block>                 synopsis) const
+    const cppast::cpp_entity_index&                          index,
+    type_safe::optional_ref<detail::inline_entity_list>      inlines,
+    type_safe::optional_ref<std::vector<documentation_page>>) const
 {
-    return begin()->do_generate_documentation(gen_config, syn_config, index, inlines,
-                                              std::move(synopsis));
+    // the synopsis of the main entity is the one of the group
+    return begin()->do_generate_documentation(gen_config, syn_config, index, inlines, nullptr);
 }
 
 std::unique_ptr<markup::documentation_entity> doc_cpp_namespace::do_generate_documentation(
     const generation_config& gen_config, const synopsis_config& syn_config,
-    const cppast::cpp_entity_index&     index, type_safe::optional_ref<detail::inline_entity_list>,
-    std::unique_ptr<markup::code_block> synopsis) const
+    const cppast::cpp_entity_index& index, type_safe::optional_ref<detail::inline_entity_list>,
+    type_safe::optional_ref<std::vector<documentation_page>> pages) const
 {
     // generate child documentation
-    std::vector<std::unique_ptr<markup::entity_documentation>> child_docs;
-    for (auto& child : *this)
-    {
-        auto child_doc =
-            child.do_generate_documentation(gen_config, syn_config, index, nullptr,
-                                            generate_synopsis(syn_config, index, child));
-        if (child_doc)
-        {
-            assert(child_doc->kind() == markup::entity_kind::entity_documentation);
-            child_docs.push_back(std::unique_ptr<markup::entity_documentation>(
-                static_cast<markup::entity_documentation*>(child_doc.release())));
-        }
-    }
+    std::vector<std::vector<documentation_page>> nested_pages(pages ? children_.size() : 0u);
+    auto generated =
+        generate_children(gen_config, *this, [&](std::size_t i, const doc_entity& child) {
+            return child.do_generate_documentation(gen_config, syn_config, index, nullptr,
+                                                   type_safe::opt_ref(
+                                                       pages ? &nested_pages[i] : nullptr));
+        });
+    auto child_docs = split_children(*this, std::move(generated), nested_pages, pages);
 
     if (child_docs.empty() && comment())
     {
@@ -920,11 +1205,14 @@ std::unique_ptr<markup::documentation_entity> doc_cpp_namespace::do_generate_doc
         markup::entity_documentation::builder builder(entity_, get_documentation_id(),
                                                       get_header(namespace_(), comment(),
                                                                  namespace_().name()),
-                                                      std::move(synopsis));
+                                                      generate_synopsis(syn_config, index, *this));
         comment::set_sections(builder, comment().value());
 
         return builder.finish();
     }
+    else if (child_docs.empty() && pages)
+        // everything is on other pages, so no need for one of the namespace
+        return nullptr;
     else
     {
         // generate empty namespace documentation
@@ -950,26 +1238,34 @@ markup::namespace_documentation::builder doc_cpp_namespace::get_builder() const
 
 std::unique_ptr<markup::documentation_entity> doc_cpp_file::do_generate_documentation(
     const generation_config& gen_config, const synopsis_config& syn_config,
-    const cppast::cpp_entity_index&     index, type_safe::optional_ref<detail::inline_entity_list>,
-    std::unique_ptr<markup::code_block> synopsis) const
+    const cppast::cpp_entity_index& index, type_safe::optional_ref<detail::inline_entity_list>,
+    type_safe::optional_ref<std::vector<documentation_page>> pages) const
 {
     markup::file_documentation::builder builder(type_safe::ref(*file_), get_documentation_id(),
                                                 get_header(*file_, comment(), output_name()),
-                                                std::move(synopsis));
+                                                generate_synopsis(syn_config, index, *this));
     if (comment())
         comment::set_sections(builder, comment().value());
 
-    for (auto& child : *this)
+    std::vector<std::vector<documentation_page>> nested_pages(pages ? children_.size() : 0u);
+    auto generated =
+        generate_children(gen_config, *this, [&](std::size_t i, const doc_entity& child) {
+            return child.do_generate_documentation(gen_config, syn_config, index, nullptr,
+                                                   type_safe::opt_ref(
+                                                       pages ? &nested_pages[i] : nullptr));
+        });
+
+    std::vector<documentation_page> file_pages;
+    for (auto& child_doc : split_children(*this, std::move(generated), nested_pages,
+                                          type_safe::opt_ref(pages ? &file_pages : nullptr)))
+        builder.add_child(std::move(child_doc));
+
+    if (!file_pages.empty())
     {
-        auto child_doc =
-            child.do_generate_documentation(gen_config, syn_config, index, nullptr,
-                                            generate_synopsis(syn_config, index, child));
-        if (child_doc)
-        {
-            assert(child_doc->kind() == markup::entity_kind::entity_documentation);
-            builder.add_child(std::unique_ptr<markup::entity_documentation>(
-                static_cast<markup::entity_documentation*>(child_doc.release())));
-        }
+        // the file only links to the pages
+        builder.add_section(get_page_summary(link_name(), file_pages));
+        for (auto& page : file_pages)
+            pages.value().push_back(std::move(page));
     }
 
     return builder.finish();
@@ -987,6 +1283,19 @@ doc_cpp_entity::builder::builder(std::string
     peek().entity().set_user_data(&peek());
 }
 
+doc_cpp_entity::builder::builder(detail::doc_entity_arena& arena, const std::string& link_name,
+                                 type_safe::object_ref<const cppast::cpp_entity>     entity,
+                                 type_safe::optional_ref<const comment::doc_comment> comment,
+                                 bool                                                set_user_data)
+: basic_builder(std::unique_ptr<doc_cpp_entity>(
+      new (arena) doc_cpp_entity(type_safe::ref(link_name), entity, std::move(comment))))
+{
+    assert(entity->kind() != cppast::cpp_file::kind()
+           && entity->kind() != cppast::cpp_namespace::kind());
+    if (set_user_data)
+        peek().entity().set_user_data(&peek());
+}
+
 doc_metadata_entity::builder::builder(type_safe::object_ref<const cppast::cpp_entity>   entity,
                                       type_safe::object_ref<const comment::doc_comment> comment)
 : basic_builder(std::unique_ptr<doc_metadata_entity>(new doc_metadata_entity(entity, comment)))
@@ -994,6 +1303,17 @@ doc_metadata_entity::builder::builder(type_safe::object_ref<const cppast::cpp_en
     peek().entity().set_user_data(&peek());
 }
 
+doc_metadata_entity::builder::builder(detail::doc_entity_arena&                         arena,
+                                      type_safe::object_ref<const cppast::cpp_entity>   entity,
+                                      type_safe::object_ref<const comment::doc_comment> comment,
+                                      bool set_user_data)
+: basic_builder(
+      std::unique_ptr<doc_metadata_entity>(new (arena) doc_metadata_entity(entity, comment)))
+{
+    if (set_user_data)
+        peek().entity().set_user_data(&peek());
+}
+
 doc_cpp_namespace::builder::builder(std::string                                         link_name,
                                     type_safe::object_ref<const cppast::cpp_namespace>  entity,
                                     type_safe::optional_ref<const comment::doc_comment> comment)
@@ -1003,16 +1323,60 @@ doc_cpp_namespace::builder::builder(std::string
     peek().namespace_().set_user_data(&peek());
 }
 
+doc_cpp_namespace::builder::builder(detail::doc_entity_arena& arena, const std::string& link_name,
+                                    type_safe::object_ref<const cppast::cpp_namespace>  entity,
+                                    type_safe::optional_ref<const comment::doc_comment> comment)
+: basic_builder(std::unique_ptr<doc_cpp_namespace>(
+      new (arena) doc_cpp_namespace(type_safe::ref(link_name), entity, std::move(comment))))
+{
+    peek().namespace_().set_user_data(&peek());
+}
+
 doc_cpp_file::builder::builder(std::string output_name, std::string link_name,
                                std::unique_ptr<cppast::cpp_file>                   file,
                                type_safe::optional_ref<const comment::doc_comment> comment)
-: basic_builder(
-      std::unique_ptr<doc_cpp_file>(new doc_cpp_file(std::move(output_name), std::move(link_name),
-                                                     std::move(file), std::move(comment))))
+: basic_builder(std::unique_ptr<doc_cpp_file>(new doc_cpp_file(nullptr, std::move(output_name),
+                                                               std::move(link_name),
+                                                               std::move(file),
+                                                               std::move(comment))))
 {
     peek().file().set_user_data(&peek());
 }
 
+doc_cpp_file::builder::builder(std::unique_ptr<detail::doc_entity_arena> arena,
+                               std::string output_name, const std::string& link_name,
+                               std::unique_ptr<cppast::cpp_file>                   file,
+                               type_safe::optional_ref<const comment::doc_comment> comment)
+: basic_builder(std::unique_ptr<doc_cpp_file>(
+      new doc_cpp_file(std::move(arena), std::move(output_name), type_safe::ref(link_name),
+                       std::move(file), std::move(comment))))
+{
+    peek().file().set_user_data(&peek());
+}
+
+doc_cpp_file::~doc_cpp_file() noexcept
+{
+    // the children might live in the arena, so destroy them before it
+    children_.clear();
+}
+
+std::vector<const cppast::cpp_file*> doc_cpp_file::get_injected_files() const
+{
+    std::vector<const cppast::cpp_file*> result;
+    for (auto& injected : injected_)
+    {
+        auto cur = type_safe::opt_ref(&*injected.first);
+        while (cur.value().parent())
+            cur = cur.value().parent();
+        assert(cur.value().kind() == cppast::cpp_file::kind());
+
+        auto file = static_cast<const cppast::cpp_file*>(&cur.value());
+        if (std::find(result.begin(), result.end(), file) == result.end())
+            result.push_back(file);
+    }
+    return result;
+}
+
 namespace
 {
     bool is_virtual(const cppast::cpp_entity& e)
@@ -1177,31 +1541,211 @@ namespace
                || e.kind() == cppast::cpp_language_linkage::kind();
     }
 
-    std::unique_ptr<doc_entity> build_entity(const comment_registry&         registry,
-                                             const cppast::cpp_entity_index& index,
-                                             const cppast::cpp_entity&       e);
+    // what is known about the entities that can't be marked, like the ones of other files,
+    // those are only read while building a file
+    struct foreign_entities
+    {
+        // the access specifiers of class members, filled for all members of a class at once
+        std::unordered_map<const cppast::cpp_entity*, cppast::cpp_access_specifier_kind> access;
+        // whether or not the entity or one of its parents is excluded
+        std::unordered_map<const cppast::cpp_entity*, bool> excluded;
+        // the doc entities that become the user data of the entities once all files are built
+        std::vector<std::pair<const cppast::cpp_entity*, doc_entity*>> injected;
+    };
+
+    // the state shared while building the doc entities of a file
+    struct build_context
+    {
+        detail::doc_entity_arena&       arena;
+        const comment_registry&         registry;
+        unique_name_table&              names;
+        foreign_entities&               foreign;
+        const cppast::cpp_entity_index& index;
+        const cppast::cpp_file&         file;
+        // set if the entities are excluded while building them,
+        // otherwise exclude_entities() must have been called for all files
+        type_safe::optional_ref<const entity_blacklist> blacklist;
+        // whether entities are marked while building them,
+        // false for injected entities, they were marked already or belong to another file
+        bool mark;
+    };
+
+    const cppast::cpp_entity& get_root(const cppast::cpp_entity& e)
+    {
+        auto cur = &e;
+        while (cur->parent())
+            cur = &cur->parent().value();
+        return *cur;
+    }
+
+    // whether or not the marks of the entity can be used,
+    // the entities of other files may be built concurrently
+    bool has_marks(const build_context& ctx, const cppast::cpp_entity& e)
+    {
+        return !ctx.blacklist || &get_root(e) == &ctx.file;
+    }
+
+    // the access specifier of the entity in its parent, as reported by cppast::visit()
+    cppast::cpp_access_specifier_kind get_access(const build_context&      ctx,
+                                                 const cppast::cpp_entity& e)
+    {
+        if (e.kind() == cppast::cpp_base_class::kind())
+            return static_cast<const cppast::cpp_base_class&>(e).access_specifier();
+        else if (!e.parent() || e.parent().value().kind() != cppast::cpp_class::kind())
+            return cppast::cpp_public;
+
+        auto iter = ctx.foreign.access.find(&e);
+        if (iter == ctx.foreign.access.end())
+        {
+            // walk the class once and remember the access of all members
+            auto& c      = static_cast<const cppast::cpp_class&>(e.parent().value());
+            auto  access = c.class_kind() == cppast::cpp_class_kind::class_t ?
+                              cppast::cpp_private :
+                              cppast::cpp_public;
+            for (auto& member : c)
+            {
+                if (member.kind() == cppast::cpp_access_specifier::kind())
+                    access =
+                        static_cast<const cppast::cpp_access_specifier&>(member).access_specifier();
+                ctx.foreign.access.emplace(&member, access);
+            }
+
+            iter = ctx.foreign.access.find(&e);
+            assert(iter != ctx.foreign.access.end());
+        }
+        return iter->second;
+    }
+
+    // whether or not the entity itself is excluded
+    bool is_marked_excluded(const build_context& ctx, const cppast::cpp_entity& e,
+                            cppast::cpp_access_specifier_kind access)
+    {
+        if (has_marks(ctx, e))
+            return e.user_data() == &excluded_entity;
+        return is_excluded(e, access, ctx.registry.get_comment(e), ctx.index,
+                           ctx.blacklist.value());
+    }
+
+    // whether or not the entity or one of its parents is excluded
+    bool is_marked_parent_excluded(const build_context& ctx, const cppast::cpp_entity& e)
+    {
+        if (has_marks(ctx, e) && (!ctx.blacklist || e.user_data()))
+            return e.user_data() == &excluded_entity || e.user_data() == &parent_excluded_entity;
+
+        // not marked (yet), so compute it from the comments and the blacklist like the marks,
+        // the parents are shared by many entities, so remember it
+        auto iter = ctx.foreign.excluded.find(&e);
+        if (iter != ctx.foreign.excluded.end())
+            return iter->second;
+
+        auto result = is_excluded(e, get_access(ctx, e), ctx.registry.get_comment(e), ctx.index,
+                                  ctx.blacklist.value())
+                      || (e.parent() && is_marked_parent_excluded(ctx, e.parent().value()));
+        ctx.foreign.excluded.emplace(&e, result);
+        return result;
+    }
+
+    // whether or not the doc entity can be set as user data of the entity while building,
+    // only injected entities can belong to other files
+    bool can_set_user_data(const build_context& ctx, const cppast::cpp_entity& e)
+    {
+        return ctx.mark || has_marks(ctx, e);
+    }
+
+    // sets the doc entity as user data of the entity once all files are built
+    void defer_user_data(const build_context& ctx, const cppast::cpp_entity& e, doc_entity& doc)
+    {
+        ctx.foreign.injected.emplace_back(&e, &doc);
+    }
+
+    void set_excluded(const build_context& ctx, const cppast::cpp_entity& e)
+    {
+        if (has_marks(ctx, e))
+            e.set_user_data(&excluded_entity);
+    }
+
+    void exclude_entities_impl(const comment_registry&         registry,
+                               const cppast::cpp_entity_index& index,
+                               const entity_blacklist& blacklist, const cppast::cpp_entity& root,
+                               bool include_root)
+    {
+        auto exclude_if_necessary = [&](const cppast::cpp_entity&         entity,
+                                        cppast::cpp_access_specifier_kind access) {
+            auto comment = registry.get_comment(entity);
+            if (is_excluded(entity, access, comment, index, blacklist))
+                entity.set_user_data(&excluded_entity);
+            else if (entity.parent() && entity.parent().value().user_data())
+                // parent excluded, so exclude this as well
+                entity.set_user_data(&parent_excluded_entity);
+        };
+
+        cppast::visit(root,
+                      [&](const cppast::cpp_entity& entity, const cppast::visitor_info& info) {
+                          if (info.is_old_entity())
+                              return;
+
+                          if (include_root || &entity != &root)
+                              exclude_if_necessary(entity, info.access);
+
+                          // handle inline entities
+                          if (auto templ = detail::get_template(entity))
+                              for (auto& param : templ.value().parameters())
+                                  exclude_if_necessary(param, cppast::cpp_public);
+                          if (auto func = detail::get_function(entity))
+                              for (auto& param : func.value().parameters())
+                                  exclude_if_necessary(param, cppast::cpp_public);
+                          if (auto c = detail::get_class(entity))
+                              for (auto& base : c.value().bases())
+                                  exclude_if_necessary(base, base.access_specifier());
+                      });
+    }
+
+    // marks the entity like exclude_entities() would,
+    // the parents of the entities that are built are never excluded
+    void mark_entity(const build_context& ctx, const cppast::cpp_entity& e,
+                     cppast::cpp_access_specifier_kind access)
+    {
+        if (e.user_data())
+            // already built as member of a group
+            return;
+        else if (is_excluded(e, access, ctx.registry.get_comment(e), ctx.index,
+                             ctx.blacklist.value()))
+        {
+            e.set_user_data(&excluded_entity);
+            exclude_entities_impl(ctx.registry, ctx.index, ctx.blacklist.value(), e, false);
+        }
+        else if (cppast::is_template(e.kind()))
+            mark_entity(ctx, *static_cast<const cppast::cpp_template&>(e).begin(),
+                        cppast::cpp_public);
+        else if (e.kind() == cppast::cpp_friend::kind())
+        {
+            auto& friend_ = static_cast<const cppast::cpp_friend&>(e);
+            if (friend_.entity())
+                mark_entity(ctx, friend_.entity().value(), cppast::cpp_public);
+        }
+    }
+
+    std::unique_ptr<doc_entity> build_entity(const build_context& ctx, const cppast::cpp_entity& e,
+                                             cppast::cpp_access_specifier_kind access);
 
     type_safe::optional_ref<const cppast::cpp_class> is_excluded_base(
-        const comment_registry& registry, const cppast::cpp_entity_index& index,
-        const cppast::cpp_base_class& base)
+        const build_context& ctx, const cppast::cpp_base_class& base)
     {
-        auto base_class = cppast::get_class(index, base);
+        auto base_class = cppast::get_class(ctx.index, base);
         auto entity     = base_class && cppast::is_templated(base_class.value()) ?
                           base_class.value().parent() :
                           base_class;
-        auto comment = base_class ? registry.get_comment(entity.value()) : nullptr;
 
         if (!base_class)
             return nullptr;
 
-        auto is_excluded = entity.value().user_data() == &excluded_entity
-                           || entity.value().user_data() == &parent_excluded_entity;
+        auto is_excluded = is_marked_parent_excluded(ctx, entity.value());
         if (base.access_specifier() != cppast::cpp_private && base_class && is_excluded)
             return base_class;
         else if (is_excluded)
         {
             // exclude base class declaration
-            base.set_user_data(&excluded_entity);
+            set_excluded(ctx, base);
             return nullptr;
         }
         else
@@ -1209,36 +1753,42 @@ namespace
     }
 
     template <class Visitor>
-    void handle_bases(const Visitor& visitor, const comment_registry& registry,
-                      const cppast::cpp_entity_index& index, const cppast::cpp_class& c,
+    void handle_bases(const Visitor& visitor, const build_context& ctx, const cppast::cpp_class& c,
                       bool recursive = false)
     {
         for (auto& base : c.bases())
         {
-            if (auto base_class = is_excluded_base(registry, index, base))
+            if (auto base_class = is_excluded_base(ctx, base))
             {
                 // we have an excluded but public base class
                 // treat its children like children of the derived class
-                base.set_user_data(&excluded_entity);
-                handle_bases(visitor, registry, index, base_class.value(), true);
+                set_excluded(ctx, base);
+                handle_bases(visitor, ctx, base_class.value(), true);
                 detail::visit_children(base_class.value(),
-                                       [&](const cppast::cpp_entity& e) { visitor(e, true); });
+                                       [&](const cppast::cpp_entity&         e,
+                                           cppast::cpp_access_specifier_kind access) {
+                                           visitor(e, access, true);
+                                       });
             }
             else if (!recursive)
                 // add to top level class
-                visitor(base, false);
+                visitor(base, base.access_specifier(), false);
         }
     }
 
-    std::unique_ptr<doc_cpp_entity> build_cpp_entity(const comment_registry&         registry,
-                                                     const cppast::cpp_entity_index& index,
-                                                     const cppast::cpp_entity&       e)
+    std::unique_ptr<doc_cpp_entity> build_cpp_entity(const build_context&      ctx,
+                                                     const cppast::cpp_entity& e)
     {
-        auto                    link_name = lookup_unique_name(registry, e);
-        doc_cpp_entity::builder builder(link_name, type_safe::ref(e), registry.get_comment(e));
+        auto set_user_data = can_set_user_data(ctx, e);
+        doc_cpp_entity::builder builder(ctx.arena, ctx.names.lookup(e), type_safe::ref(e),
+                                        ctx.registry.get_comment(e), set_user_data);
+
+        auto injected_ctx = ctx;
+        injected_ctx.mark = false;
 
-        auto visitor = [&](const cppast::cpp_entity& entity, bool injected) {
-            if (auto child = build_entity(registry, index, entity))
+        auto visitor = [&](const cppast::cpp_entity& entity,
+                           cppast::cpp_access_specifier_kind access, bool injected) {
+            if (auto child = build_entity(injected ? injected_ctx : ctx, entity, access))
             {
                 if (injected)
                     child->mark_injected();
@@ -1249,40 +1799,51 @@ namespace
         // handle inline entities
         if (auto templ = detail::get_template(e))
             for (auto& param : templ.value().parameters())
-                visitor(param, false);
+                visitor(param, cppast::cpp_public, false);
         if (auto func = detail::get_function(e))
             for (auto& param : func.value().parameters())
-                visitor(param, false);
+                visitor(param, cppast::cpp_public, false);
         if (auto c = detail::get_class(e))
-            handle_bases(visitor, registry, index, c.value());
+            handle_bases(visitor, ctx, c.value());
 
-        detail::visit_children(e, [&](const cppast::cpp_entity& e) { visitor(e, false); });
+        detail::visit_children(e, [&](const cppast::cpp_entity&         e,
+                                      cppast::cpp_access_specifier_kind access) {
+            visitor(e, access, false);
+        });
 
-        return builder.finish();
+        auto result = builder.finish();
+        if (!set_user_data)
+            defer_user_data(ctx, e, *result);
+        return result;
     }
 
-    std::unique_ptr<doc_metadata_entity> build_metadata_entity(
-        const comment_registry& registry, const cppast::cpp_entity_index& index,
-        const cppast::cpp_entity& e)
+    std::unique_ptr<doc_metadata_entity> build_metadata_entity(const build_context&      ctx,
+                                                               const cppast::cpp_entity& e)
     {
-        auto comment = registry.get_comment(e);
+        auto comment = ctx.registry.get_comment(e);
         if (!comment)
             return nullptr;
 
-        doc_metadata_entity::builder builder(type_safe::ref(e), type_safe::ref(comment.value()));
-        detail::visit_children(e, [&](const cppast::cpp_entity& entity) {
-            if (auto child = build_entity(registry, index, entity))
+        auto set_user_data = can_set_user_data(ctx, e);
+        doc_metadata_entity::builder builder(ctx.arena, type_safe::ref(e),
+                                             type_safe::ref(comment.value()), set_user_data);
+        detail::visit_children(e, [&](const cppast::cpp_entity&         entity,
+                                      cppast::cpp_access_specifier_kind access) {
+            if (auto child = build_entity(ctx, entity, access))
                 builder.add_child(std::move(child));
         });
-        return builder.finish();
+
+        auto result = builder.finish();
+        if (!set_user_data)
+            defer_user_data(ctx, e, *result);
+        return result;
     }
 
     std::unique_ptr<doc_member_group_entity> build_member_group(
-        const comment_registry& registry, const cppast::cpp_entity_index& index,
-        const std::string& group_name, const cppast::cpp_entity& e)
+        const build_context& ctx, const std::string& group_name, const cppast::cpp_entity& e)
     {
         // may contain entities from a different parent
-        auto global_group = registry.lookup_group(group_name);
+        auto global_group = ctx.registry.lookup_group(group_name);
 
         // get entities that have the same parent
         std::vector<type_safe::object_ref<const cppast::cpp_entity>> group;
@@ -1298,31 +1859,39 @@ namespace
         else
         {
             // e is the main entity, so build group
-            doc_member_group_entity::builder builder(group_name);
+            // the first member gets the group as user data
+            auto set_user_data = can_set_user_data(ctx, e);
+
+            doc_member_group_entity::builder builder(ctx.arena, group_name);
             for (auto& member : group)
-                builder.add_member(build_cpp_entity(registry, index, *member));
-            return builder.finish();
+                builder.add_member(build_cpp_entity(ctx, *member), set_user_data);
+
+            auto result = builder.finish();
+            if (!set_user_data)
+                defer_user_data(ctx, *group.front(), *result);
+            return result;
         }
     }
 
-    std::unique_ptr<doc_cpp_namespace> build_namespace(const comment_registry&         registry,
-                                                       const cppast::cpp_entity_index& index,
-                                                       const cppast::cpp_namespace&    ns)
+    std::unique_ptr<doc_cpp_namespace> build_namespace(const build_context&         ctx,
+                                                       const cppast::cpp_namespace& ns)
     {
-        doc_cpp_namespace::builder builder(lookup_unique_name(registry, ns), type_safe::ref(ns),
-                                           registry.get_comment(ns));
+        doc_cpp_namespace::builder builder(ctx.arena, ctx.names.lookup(ns), type_safe::ref(ns),
+                                           ctx.registry.get_comment(ns));
 
-        detail::visit_children(ns, [&](const cppast::cpp_entity& entity) {
-            if (auto child = build_entity(registry, index, entity))
+        detail::visit_children(ns, [&](const cppast::cpp_entity&         entity,
+                                       cppast::cpp_access_specifier_kind access) {
+            if (auto child = build_entity(ctx, entity, access))
                 builder.add_child(std::move(child));
         });
 
         return builder.finish();
     }
 
-    bool build_is_excluded(const cppast::cpp_entity_index& index, const cppast::cpp_entity& e)
+    bool build_is_excluded(const build_context& ctx, const cppast::cpp_entity& e,
+                           cppast::cpp_access_specifier_kind access)
     {
-        if (e.user_data() == &excluded_entity)
+        if (is_marked_excluded(ctx, e, access))
             // allow parent_excluded_entity here, will not be visited unless injected
             return true;
         else if (cppast::is_templated(e) || cppast::is_friended(e))
@@ -1330,40 +1899,74 @@ namespace
             return true;
         else if (e.kind() == cppast::cpp_using_declaration::kind())
         {
-            auto target = static_cast<const cppast::cpp_using_declaration&>(e).target().get(index);
+            auto target =
+                static_cast<const cppast::cpp_using_declaration&>(e).target().get(ctx.index);
             // excluded if all of the targets are excluded
             auto targets_excluded =
                 std::all_of(target.begin(), target.end(),
                             [&](const type_safe::object_ref<const cppast::cpp_entity>& entity) {
-                                return entity->user_data() == &excluded_entity
-                                       || entity->user_data() == &parent_excluded_entity;
+                                return is_marked_parent_excluded(ctx, *entity);
                             });
             if (targets_excluded)
-                e.set_user_data(&excluded_entity);
+                set_excluded(ctx, e);
             return targets_excluded;
         }
         else
             return false;
     }
 
-    std::unique_ptr<doc_entity> build_entity(const comment_registry&         registry,
-                                             const cppast::cpp_entity_index& index,
-                                             const cppast::cpp_entity&       e)
+    std::unique_ptr<doc_entity> build_entity(const build_context& ctx, const cppast::cpp_entity& e,
+                                             cppast::cpp_access_specifier_kind access)
     {
-        auto comment = registry.get_comment(e);
-        if (build_is_excluded(index, e))
+        if (ctx.blacklist && ctx.mark)
+            mark_entity(ctx, e, access);
+
+        auto comment = ctx.registry.get_comment(e);
+        if (build_is_excluded(ctx, e, access))
             return nullptr;
         else if (is_ignored(e)
                  || (e.kind() == cppast::cpp_friend::kind() && !is_friend_func_def(e)))
             // those can only be documented as metadata
-            return build_metadata_entity(registry, index, e);
+            return build_metadata_entity(ctx, e);
         else if (e.kind() == cppast::cpp_namespace::kind())
-            return build_namespace(registry, index, static_cast<const cppast::cpp_namespace&>(e));
+            return build_namespace(ctx, static_cast<const cppast::cpp_namespace&>(e));
         else if (comment.has_value() && comment.value().metadata().group())
-            return build_member_group(registry, index,
-                                      comment.value().metadata().group().value().name(), e);
+            return build_member_group(ctx, comment.value().metadata().group().value().name(), e);
         else
-            return build_cpp_entity(registry, index, e);
+            return build_cpp_entity(ctx, e);
+    }
+
+    std::unique_ptr<doc_cpp_file> build_file(
+        type_safe::object_ref<const comment_registry>   registry,
+        const cppast::cpp_entity_index&                 index,
+        type_safe::optional_ref<const entity_blacklist> blacklist,
+        std::unique_ptr<cppast::cpp_file> file, std::string output_name)
+    {
+        auto& f = *file;
+
+        auto comment = registry->get_comment(f);
+        if (comment && comment.value().metadata().output_name())
+            output_name = comment.value().metadata().output_name().value();
+
+        // the entities borrow their link names from the table, so it lives in the arena as well
+        std::unique_ptr<detail::doc_entity_arena> arena(new detail::doc_entity_arena);
+        auto&            names = arena->create<unique_name_table>(*registry);
+        foreign_entities foreign;
+        build_context    ctx{*arena, *registry, names, foreign, index, f, blacklist, true};
+
+        auto&                 link_name = names.lookup(f);
+        doc_cpp_file::builder builder(std::move(arena), std::move(output_name), link_name,
+                                      std::move(file), comment);
+
+        detail::visit_children(f, [&](const cppast::cpp_entity&         entity,
+                                      cppast::cpp_access_specifier_kind access) {
+            if (auto child = build_entity(ctx, entity, access))
+                builder.add_child(std::move(child));
+        });
+
+        for (auto& injected : foreign.injected)
+            builder.add_injected_entity(*injected.first, *injected.second);
+        return builder.finish();
     }
 }
 
@@ -1371,52 +1974,27 @@ void standardese::exclude_entities(const comment_registry&         registry,
                                    const cppast::cpp_entity_index& index,
                                    const entity_blacklist& blacklist, const cppast::cpp_file& file)
 {
-    auto exclude_if_necessary = [&](const cppast::cpp_entity&         entity,
-                                    cppast::cpp_access_specifier_kind access) {
-        auto comment = registry.get_comment(entity);
-        if (is_excluded(entity, access, comment, index, blacklist))
-            entity.set_user_data(&excluded_entity);
-        else if (entity.parent() && entity.parent().value().user_data())
-            // parent excluded, so exclude this as well
-            entity.set_user_data(&parent_excluded_entity);
-    };
-
-    cppast::visit(file, [&](const cppast::cpp_entity& entity, const cppast::visitor_info& info) {
-        if (info.is_old_entity())
-            return;
-
-        exclude_if_necessary(entity, info.access);
+    exclude_entities_impl(registry, index, blacklist, file, true);
+}
 
-        // handle inline entities
-        if (auto templ = detail::get_template(entity))
-            for (auto& param : templ.value().parameters())
-                exclude_if_necessary(param, cppast::cpp_public);
-        if (auto func = detail::get_function(entity))
-            for (auto& param : func.value().parameters())
-                exclude_if_necessary(param, cppast::cpp_public);
-        if (auto c = detail::get_class(entity))
-            for (auto& base : c.value().bases())
-                exclude_if_necessary(base, base.access_specifier());
-    });
+void standardese::register_injected_entities(const doc_cpp_file& file)
+{
+    for (auto& injected : file.injected_)
+        injected.first->set_user_data(&*injected.second);
 }
 
 std::unique_ptr<doc_cpp_file> standardese::build_doc_entities(
     type_safe::object_ref<const comment_registry> registry, const cppast::cpp_entity_index& index,
     std::unique_ptr<cppast::cpp_file> file, std::string output_name)
 {
-    auto& f = *file;
-
-    auto comment = registry->get_comment(f);
-    if (comment && comment.value().metadata().output_name())
-        output_name = comment.value().metadata().output_name().value();
-
-    doc_cpp_file::builder builder(std::move(output_name), lookup_unique_name(*registry, f),
-                                  std::move(file), comment);
-
-    detail::visit_children(f, [&](const cppast::cpp_entity& entity) {
-        if (auto child = build_entity(*registry, index, entity))
-            builder.add_child(std::move(child));
-    });
+    return build_file(registry, index, nullptr, std::move(file), std::move(output_name));
+}
 
-    return builder.finish();
+std::unique_ptr<doc_cpp_file> standardese::build_doc_entities(
+    type_safe::object_ref<const comment_registry> registry, const cppast::cpp_entity_index& index,
+    const entity_blacklist& blacklist, std::unique_ptr<cppast::cpp_file> file,
+    std::string output_name)
+{
+    return build_file(registry, index, type_safe::opt_ref(&blacklist), std::move(file),
+                      std::move(output_name));
 }
@@ -55,6 +55,7 @@ namespace standardese
             visit_namespace_level(file, ef, [](const cppast::cpp_namespace&) {});
         }
 
+        // calls f with each child and its access specifier
         template <typename Func>
         void visit_children(const cppast::cpp_entity& entity, Func f)
         {
@@ -74,12 +75,12 @@ namespace standardese
                                   return cppast::continue_visit;
                               else if (info.event == cppast::visitor_info::container_entity_enter)
                               {
-                                  f(child);
+                                  f(child, info.access);
                                   return cppast::continue_visit_no_children; // don't visit children
                               }
                               else if (info.event == cppast::visitor_info::leaf_entity)
                               {
-                                  f(child);
+                                  f(child, info.access);
                                   return cppast::continue_visit; //continue
                               }
                               else
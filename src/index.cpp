@@ -87,14 +87,26 @@ void entity_index::register_entity(std::string link_name, const cppast::cpp_enti
 {
     assert(e.kind() != cppast::cpp_file::kind() && e.kind() != cppast::cpp_namespace::kind());
     if (e.kind() != cppast::cpp_include_directive::kind()) // don't insert includes
-        insert(entity(get_entity_entry(e.name(), std::move(link_name), brief), e.name(),
-                      get_scope(e)));
+        register_entity(std::move(link_name), e.name(), get_scope(e), brief);
+}
+
+void entity_index::register_entity(std::string link_name, std::string name, std::string scope,
+                                   type_safe::optional_ref<const markup::brief_section> brief) const
+{
+    auto doc = get_entity_entry(name, std::move(link_name), brief);
+    insert(entity(std::move(doc), std::move(name), std::move(scope)));
 }
 
 void entity_index::register_namespace(const cppast::cpp_namespace&             ns,
                                       markup::namespace_documentation::builder doc) const
 {
-    insert(entity(std::move(doc), ns.name(), get_scope(ns)));
+    register_namespace(ns.name(), get_scope(ns), std::move(doc));
+}
+
+void entity_index::register_namespace(std::string name, std::string scope,
+                                      markup::namespace_documentation::builder doc) const
+{
+    insert(entity(std::move(doc), std::move(name), std::move(scope)));
 }
 
 namespace
@@ -263,6 +275,13 @@ void module_index::register_module(markup::module_documentation::builder doc) co
 bool module_index::register_entity(std::string module, std::string link_name,
                                    const cppast::cpp_entity&                            entity,
                                    type_safe::optional_ref<const markup::brief_section> brief) const
+{
+    return register_entity(std::move(module), std::move(link_name), entity.name(), brief);
+}
+
+bool module_index::register_entity(std::string module, std::string link_name,
+                                   const std::string&                                   name,
+                                   type_safe::optional_ref<const markup::brief_section> brief) const
 {
     std::lock_guard<std::mutex> lock(mutex_);
     auto                        iter = std::lower_bound(modules_.begin(), modules_.end(), module,
@@ -270,7 +289,7 @@ bool module_index::register_entity(std::string module, std::string link_name,
                                     const std::string& rhs) { return lhs.id().as_str() < rhs; });
     if (iter == modules_.end() || iter->id().as_str() != module)
         return false;
-    iter->add_child(get_entity_entry(entity.name(), std::move(link_name), std::move(brief)));
+    iter->add_child(get_entity_entry(name, std::move(link_name), std::move(brief)));
     return true;
 }
 
@@ -287,11 +306,10 @@ std::unique_ptr<markup::module_index> module_index::generate() const
     return builder.finish();
 }
 
-void standardese::register_module_entities(const module_index&     index,
-                                           const comment_registry& registry,
-                                           const cppast::cpp_file& file)
+namespace
 {
-    auto get_module = [&](const cppast::cpp_entity& e) -> type_safe::optional<std::string> {
+    type_safe::optional<std::string> get_module(const cppast::cpp_entity& e)
+    {
         if (auto doc_e = static_cast<const doc_entity*>(e.user_data()))
         {
             if (doc_e->comment())
@@ -299,16 +317,11 @@ void standardese::register_module_entities(const module_index&     index,
         }
 
         return type_safe::nullopt;
-    };
-
-    auto register_entity = [&](std::string module, const cppast::cpp_entity& e) {
-        assert(e.user_data());
-        auto& doc_e = *static_cast<const doc_entity*>(e.user_data());
-        return index.register_entity(std::move(module), doc_e.link_name(), e,
-                                     doc_e.comment().value().brief_section());
-    };
+    }
 
-    auto get_module_doc = [&](const std::string& name) {
+    markup::module_documentation::builder get_module_doc(const comment_registry& registry,
+                                                         const std::string&      name)
+    {
         markup::module_documentation::builder builder(markup::block_id(name),
                                                       markup::heading::builder(markup::block_id())
                                                           .add_child(markup::text::build("Module "))
@@ -319,6 +332,18 @@ void standardese::register_module_entities(const module_index&     index,
             comment::set_sections(builder, module_comment.value());
 
         return builder;
+    }
+}
+
+void standardese::register_module_entities(const module_index&     index,
+                                           const comment_registry& registry,
+                                           const cppast::cpp_file& file)
+{
+    auto register_entity = [&](std::string module, const cppast::cpp_entity& e) {
+        assert(e.user_data());
+        auto& doc_e = *static_cast<const doc_entity*>(e.user_data());
+        return index.register_entity(std::move(module), doc_e.link_name(), e,
+                                     doc_e.comment().value().brief_section());
     };
 
     cppast::visit(file, [&](const cppast::cpp_entity& e, const cppast::visitor_info& info) {
@@ -328,7 +353,7 @@ void standardese::register_module_entities(const module_index&     index,
             if (module && !register_entity(module.value(), e))
             {
                 // need to register module
-                auto module_doc = get_module_doc(module.value());
+                auto module_doc = get_module_doc(registry, module.value());
                 index.register_module(std::move(module_doc));
 
                 // can register again now
@@ -340,3 +365,101 @@ void standardese::register_module_entities(const module_index&     index,
         return true;
     });
 }
+
+namespace
+{
+    std::unique_ptr<markup::brief_section> clone_brief(
+        type_safe::optional_ref<const markup::brief_section> brief)
+    {
+        return brief ? markup::clone(brief.value()) : nullptr;
+    }
+
+    type_safe::optional_ref<const markup::brief_section> get_brief(const doc_entity& doc_e)
+    {
+        return doc_e.comment() ? doc_e.comment().value().brief_section() : nullptr;
+    }
+
+    type_safe::optional_ref<const markup::brief_section> get_brief(
+        const std::unique_ptr<markup::brief_section>& brief)
+    {
+        return type_safe::opt_ref(static_cast<const markup::brief_section*>(brief.get()));
+    }
+}
+
+index_entries standardese::get_index_entries(const comment_registry& registry,
+                                             const doc_cpp_file&     file)
+{
+    index_entries result;
+
+    // same as register_index_entities()
+    detail::visit_namespace_level(file.file(),
+                                  [&](const cppast::cpp_entity& entity) {
+                                      auto doc_e =
+                                          static_cast<const doc_entity*>(entity.user_data());
+                                      if (doc_e && !doc_e->is_excluded()
+                                          && entity.kind()
+                                                 != cppast::cpp_include_directive::kind())
+                                          result.entities.push_back(
+                                              {doc_e->link_name(), entity.name(),
+                                               get_scope(entity), clone_brief(get_brief(*doc_e))});
+                                  },
+                                  [&](const cppast::cpp_namespace& ns) {
+                                      auto doc_e = static_cast<const doc_entity*>(ns.user_data());
+                                      if (doc_e && !doc_e->is_excluded())
+                                          result.namespaces.push_back(
+                                              {ns.name(), get_scope(ns),
+                                               static_cast<const doc_cpp_namespace*>(doc_e)
+                                                   ->get_builder()
+                                                   .finish()});
+                                  });
+
+    // same as register_module_entities()
+    cppast::visit(file.file(),
+                  [&](const cppast::cpp_entity& e, const cppast::visitor_info& info) {
+                      if (info.event != cppast::visitor_info::container_entity_exit)
+                          if (auto module = get_module(e))
+                          {
+                              auto& doc_e = *static_cast<const doc_entity*>(e.user_data());
+                              result.module_entities.push_back({module.value(), doc_e.link_name(),
+                                                                e.name(),
+                                                                clone_brief(get_brief(doc_e))});
+                          }
+                      return true;
+                  });
+
+    std::vector<std::string> modules;
+    for (auto& entry : result.module_entities)
+        modules.push_back(entry.module);
+    std::sort(modules.begin(), modules.end());
+    modules.erase(std::unique(modules.begin(), modules.end()), modules.end());
+    for (auto& module : modules)
+        result.modules.push_back(get_module_doc(registry, module).finish());
+
+    result.file = {file.link_name(), file.output_name(), "", clone_brief(get_brief(file))};
+
+    return result;
+}
+
+void standardese::register_index_entries(const entity_index& eindex, const file_index& findex,
+                                         const module_index& mindex, const index_entries& entries)
+{
+    for (auto& entry : entries.entities)
+        eindex.register_entity(entry.link_name, entry.name, entry.scope,
+                               get_brief(entry.brief));
+    for (auto& entry : entries.namespaces)
+        eindex.register_namespace(entry.name, entry.scope,
+                                  markup::namespace_documentation::builder(
+                                      markup::clone(*entry.doc)));
+
+    for (auto& module : entries.modules)
+        mindex.register_module(markup::module_documentation::builder(markup::clone(*module)));
+    for (auto& entry : entries.module_entities)
+    {
+        auto result = mindex.register_entity(entry.module, entry.link_name, entry.name,
+                                             get_brief(entry.brief));
+        assert(result);
+    }
+
+    findex.register_file(entries.file.link_name, entries.file.name,
+                         get_brief(entries.file.brief));
+}
@@ -100,7 +100,15 @@ namespace
 bool linker::register_documentation(std::string link_name, const markup::document_entity& document,
                                     const markup::block_id& documentation, bool force) const
 {
-    auto ref = markup::block_reference(document.output_name(), documentation);
+    return register_documentation(std::move(link_name),
+                                  markup::block_reference(document.output_name(), documentation),
+                                  force);
+}
+
+bool linker::register_documentation(std::string link_name, markup::block_reference ref,
+                                    bool force) const
+{
+    assert(ref.document());
 
     link_name       = process_link_name(std::move(link_name));
     auto short_name = short_link_name(link_name);
@@ -176,11 +184,36 @@ namespace
         }
         return result;
     }
+
+    // the scopes a namespace declared in the given scope and its parents look up names in,
+    // the same as walking the parents of the namespace, as the names can't contain `::`
+    std::vector<std::string> get_namespace_scopes(const std::string& scope)
+    {
+        std::vector<std::string> result(1u, scope);
+        while (!result.back().empty())
+        {
+            // remove the last name and its `::`
+            auto& cur    = result.back();
+            auto  end    = cur.rfind("::", cur.size() - 3u);
+            auto  parent = end == std::string::npos ? std::string() : cur.substr(0u, end + 2u);
+            result.push_back(std::move(parent));
+        }
+        return result;
+    }
 }
 
 type_safe::variant<type_safe::nullvar_t, markup::block_reference, markup::url> linker::
     lookup_documentation(type_safe::optional_ref<const cppast::cpp_entity> context,
                          std::string                                       link_name) const
+{
+    std::vector<std::string> scopes;
+    for (; context; context = context.value().parent())
+        scopes.push_back(get_entity_scope(context.value()));
+    return lookup_documentation(scopes, std::move(link_name));
+}
+
+type_safe::variant<type_safe::nullvar_t, markup::block_reference, markup::url> linker::
+    lookup_documentation(const std::vector<std::string>& scopes, std::string link_name) const
 {
     auto relative = is_relative(link_name);
     link_name     = process_link_name(std::move(link_name));
@@ -209,15 +242,10 @@ type_safe::variant<type_safe::nullvar_t, markup::block_reference, markup::url> l
     else
     {
         // relative lookup
-        while (context)
-        {
-            if (auto result = do_lookup(get_entity_scope(context.value()) + link_name))
+        for (auto& scope : scopes)
+            if (auto result = do_lookup(scope + link_name))
                 return result;
 
-            // go to parent
-            context = context.value().parent();
-        }
-
         return type_safe::nullvar;
     }
 }
@@ -272,71 +300,153 @@ namespace
             return doc_e.kind() != doc_entity::metadata;
     }
 
-    void register_documentation(const cppast::diagnostic_logger& logger, const linker& l,
-                                const markup::document_entity& document, const doc_entity& doc_e)
+    template <typename Func>
+    void for_each_registration(const doc_entity& doc_e, const Func& f)
     {
-        auto result = l.register_documentation(doc_e.link_name(), document,
-                                               doc_e.get_documentation_id(), force_linking(doc_e));
-        if (!result)
-            logger.log("standardese linker",
-                       make_diagnostic(cppast::source_location::make_entity(
-                                           doc_e.get_documentation_id().as_str()),
-                                       "duplicate registration of link name '", doc_e.link_name(),
-                                       "'"));
+        f(doc_e.link_name(), doc_e.get_documentation_id(), force_linking(doc_e));
 
         for (auto& child : doc_e)
             if ((doc_e.is_injected() && doc_e.kind() == doc_entity::member_group)
                 || child.is_injected())
                 // need to register documentation for all injected children,
                 // but also all children of injected member groups
-                register_documentation(logger, l, document, child);
+                for_each_registration(child, f);
+    }
+
+    // the entities whose documentation is on its own page,
+    // and the index of the document containing the page
+    using page_map = std::unordered_map<const doc_entity*, std::size_t>;
+
+    page_map get_pages(const std::vector<const markup::document_entity*>& documents)
+    {
+        page_map result;
+        for (auto i = 0u; i != documents.size(); ++i)
+            for (auto& child : *documents[i])
+                // other documentations are nested in a file documentation
+                if (child.kind() == markup::entity_kind::entity_documentation)
+                {
+                    auto& entity = static_cast<const markup::entity_documentation&>(child).entity();
+                    if (auto user_data = entity.user_data())
+                        result.emplace(static_cast<const doc_entity*>(user_data), i);
+                }
+        return result;
+    }
+
+    // returns the index of the document containing the page of the entity, if it has one
+    type_safe::optional<std::size_t> get_page(const page_map& pages, const cppast::cpp_entity& e)
+    {
+        if (pages.empty() || !e.user_data())
+            return type_safe::nullopt;
+
+        auto& doc_e = *static_cast<const doc_entity*>(e.user_data());
+        auto  iter  = pages.find(&doc_e);
+        if (iter == pages.end() && doc_e.parent()
+            && doc_e.parent().value().kind() == doc_entity::member_group)
+            // documented on the page of the group
+            iter = pages.find(&doc_e.parent().value());
+        return iter == pages.end() ? type_safe::nullopt : type_safe::make_optional(iter->second);
+    }
+
+    // calls the function with the index of the document for each registration
+    template <typename Func>
+    void for_each_registration(const std::vector<const markup::document_entity*>& documents,
+                               const Func&                                        f)
+    {
+        auto pages = get_pages(documents);
+
+        for (auto i = 0u; i != documents.size(); ++i)
+        {
+            auto register_doc = [&](const cppast::cpp_entity& e, std::size_t document) {
+                if (auto doc_e = get_doc_entity(e))
+                    for_each_registration(doc_e.value(), [&](const std::string&      link_name,
+                                                             const markup::block_id& id,
+                                                             bool                    force) {
+                        f(document, link_name, id, force);
+                    });
+            };
+
+            visit_documentations(
+                *documents[i],
+                [&](const markup::file_documentation& file) {
+                    // the documents of the pages the entities are in, the file is in this one
+                    std::vector<std::size_t> stack(1u, i);
+                    cppast::visit(file.file(), [&](const cppast::cpp_entity&   e,
+                                                   const cppast::visitor_info& info) {
+                        auto page = get_page(pages, e);
+                        if (info.event == cppast::visitor_info::container_entity_exit)
+                        {
+                            if (page)
+                                stack.pop_back();
+                            return true;
+                        }
+
+                        auto document = page.value_or(stack.back());
+                        if (page && info.event == cppast::visitor_info::container_entity_enter)
+                            stack.push_back(page.value());
+
+                        if (!cppast::is_templated(e) && !cppast::is_friended(e)
+                            && e.kind() != cppast::cpp_namespace::kind()) // if not already done
+                        {
+                            register_doc(e, document);
+
+                            // handle inline entities
+                            if (auto func = detail::get_function(e))
+                                for (auto& param : func.value().parameters())
+                                    register_doc(param, document);
+                            if (auto templ = detail::get_template(e))
+                                for (auto& param : templ.value().parameters())
+                                    register_doc(param, document);
+                            if (auto c = detail::get_class(e))
+                                for (auto& base : c.value().bases())
+                                    register_doc(base, document);
+                        }
+
+                        return true;
+                    });
+                },
+                [&](const markup::documentation_entity& entity) {
+                    f(i, entity.id().as_str(), entity.id(), false);
+                });
+        }
     }
 }
 
 void standardese::register_documentations(const cppast::diagnostic_logger& logger, const linker& l,
                                           const markup::document_entity& document)
 {
-    auto register_doc = [&](const cppast::cpp_entity& e) {
-        if (auto doc_e = get_doc_entity(e))
-            register_documentation(logger, l, document, doc_e.value());
-    };
+    register_documentations(logger, l, std::vector<const markup::document_entity*>{&document});
+}
+
+void standardese::register_documentations(
+    const cppast::diagnostic_logger& logger, const linker& l,
+    const std::vector<const markup::document_entity*>& documents)
+{
+    for_each_registration(documents, [&](std::size_t document, const std::string& link_name,
+                                         const markup::block_id& id, bool force) {
+        auto result = l.register_documentation(link_name, *documents[document], id, force);
+        if (!result)
+            logger.log("standardese linker",
+                       make_diagnostic(cppast::source_location::make_entity(id.as_str()),
+                                       "duplicate registration of link name '", link_name, "'"));
+    });
+}
 
-    visit_documentations(document,
-                         [&](const markup::file_documentation& file) {
-                             cppast::visit(file.file(), [&](const cppast::cpp_entity&   e,
-                                                            const cppast::visitor_info& info) {
-                                 if (info.event != cppast::visitor_info::container_entity_exit
-                                     && !cppast::is_templated(e) && !cppast::is_friended(e)
-                                     && e.kind()
-                                            != cppast::cpp_namespace::kind()) // if not already done
-                                 {
-                                     register_doc(e);
-
-                                     // handle inline entities
-                                     if (auto func = detail::get_function(e))
-                                         for (auto& param : func.value().parameters())
-                                             register_doc(param);
-                                     if (auto templ = detail::get_template(e))
-                                         for (auto& param : templ.value().parameters())
-                                             register_doc(param);
-                                     if (auto c = detail::get_class(e))
-                                         for (auto& base : c.value().bases())
-                                             register_doc(base);
-                                 }
-
-                                 return true;
-                             });
-                         },
-                         [&](const markup::documentation_entity& entity) {
-                             auto result = l.register_documentation(entity.id().as_str(), document,
-                                                                    entity.id());
-                             if (!result)
-                                 logger.log("standardese linker",
-                                            make_diagnostic(cppast::source_location::make_entity(
-                                                                entity.id().as_str()),
-                                                            "duplicate registration of link name '",
-                                                            entity.id().as_str(), "'"));
-                         });
+std::vector<documentation_registration> standardese::get_documentation_registrations(
+    const markup::document_entity& document)
+{
+    std::vector<const markup::document_entity*> documents{&document};
+    return std::move(get_documentation_registrations(documents).front());
+}
+
+std::vector<std::vector<documentation_registration>> standardese::
+    get_documentation_registrations(const std::vector<const markup::document_entity*>& documents)
+{
+    std::vector<std::vector<documentation_registration>> result(documents.size());
+    for_each_registration(documents, [&](std::size_t document, const std::string& link_name,
+                                         const markup::block_id& id, bool force) {
+        result[document].push_back(documentation_registration{link_name, id, force});
+    });
+    return result;
 }
 
 namespace
@@ -369,9 +479,6 @@ void standardese::resolve_links(const cppast::diagnostic_logger& logger, const l
         else if (entity.kind() == markup::entity_kind::entity_documentation)
             return type_safe::opt_ref(
                 &static_cast<const markup::entity_documentation&>(entity).entity());
-        else if (entity.kind() == markup::entity_kind::namespace_documentation)
-            return type_safe::opt_ref(
-                &static_cast<const markup::namespace_documentation&>(entity).namespace_());
         else
             return nullptr;
     };
@@ -385,14 +492,21 @@ void standardese::resolve_links(const cppast::diagnostic_logger& logger, const l
         return markup::block_id();
     };
 
+    // the documentation of a namespace only has its scope,
+    // the namespace may belong to a file that was already destroyed
     type_safe::optional_ref<const cppast::cpp_entity> context;
+    type_safe::optional_ref<const std::string>        namespace_scope;
     markup::visit(document, [&](const markup::entity& entity) {
         if (entity.kind() == markup::entity_kind::documentation_link)
         {
             auto& link = static_cast<const markup::documentation_link&>(entity);
             if (auto unresolved = link.unresolved_destination())
             {
-                auto destination = l.lookup_documentation(context, unresolved.value());
+                auto destination =
+                    namespace_scope ?
+                        l.lookup_documentation(get_namespace_scopes(namespace_scope.value()),
+                                               unresolved.value()) :
+                        l.lookup_documentation(context, unresolved.value());
                 if (auto block = destination.optional_value(
                         type_safe::variant_type<markup::block_reference>{}))
                 {
@@ -413,7 +527,16 @@ void standardese::resolve_links(const cppast::diagnostic_logger& logger, const l
                                                "unresolved link name '", unresolved.value(), '\''));
             }
         }
+        else if (entity.kind() == markup::entity_kind::namespace_documentation)
+        {
+            context = nullptr;
+            namespace_scope =
+                type_safe::ref(static_cast<const markup::namespace_documentation&>(entity).scope());
+        }
         else if (auto new_context = get_context(entity))
-            context = new_context;
+        {
+            context         = new_context;
+            namespace_scope = nullptr;
+        }
     });
 }
@@ -4,6 +4,8 @@
 
 #include <standardese/markup/index.hpp>
 
+#include <cppast/cpp_namespace.hpp>
+
 #include <standardese/markup/code_block.hpp>
 #include <standardese/markup/entity_kind.hpp>
 #include <standardese/markup/heading.hpp>
@@ -49,6 +51,19 @@ std::unique_ptr<entity> file_index::do_clone() const
     return b.finish();
 }
 
+std::string namespace_documentation::get_scope(const cppast::cpp_namespace& ns)
+{
+    std::string result;
+    for (auto cur = ns.parent(); cur; cur = cur.value().parent())
+    {
+        // anonymous namespaces and the file don't have a scope name
+        auto scope = cur.value().scope_name();
+        if (scope && !scope.value().name().empty())
+            result = scope.value().name() + "::" + result;
+    }
+    return result;
+}
+
 entity_kind namespace_documentation::do_get_kind() const noexcept
 {
     return entity_kind::namespace_documentation;
@@ -67,7 +82,7 @@ void namespace_documentation::do_visit(detail::visitor_callback_t cb, void* mem)
 
 std::unique_ptr<entity> namespace_documentation::do_clone() const
 {
-    builder b(ns_, id(),
+    builder b(scope_, id(),
               header() ? type_safe::make_optional(header().value().clone()) : type_safe::nullopt);
     for (auto& sec : doc_sections())
         b.add_section_impl(detail::unchecked_downcast<doc_section>(sec.clone()));
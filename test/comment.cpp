@@ -227,6 +227,148 @@ void a(float);
         for (auto entity : c)
             REQUIRE(entity->name() == "c");
     }
+    SECTION("multiple files")
+    {
+        auto file_a = parse_file({}, "comment_multiple_files_a.cpp", R"(
+/// \entity b
+/// \module b
+
+/// \group g
+/// \module a
+void a();
+)");
+        auto file_b = parse_file({}, "comment_multiple_files_b.cpp", R"(
+struct b {};
+
+/// \group g
+/// \module a
+void a(int);
+)");
+
+        file_comment_parser parser(test_logger());
+        parser.parse(type_safe::ref(*file_a));
+        parser.parse(type_safe::ref(*file_b));
+        auto registry = parser.finish();
+
+        // remote comment for an entity of another file
+        auto comment = registry.get_comment(get_named_entity(*file_b, "b"));
+        REQUIRE(comment);
+        REQUIRE(comment.value().metadata().module() == "b");
+
+        // group members from both files
+        auto group = registry.lookup_group("g");
+        REQUIRE((group.size() == 2u));
+        for (auto entity : group)
+            REQUIRE(entity->name() == "a");
+    }
+    SECTION("registry")
+    {
+        // more entities than the initial number of slots
+        std::string source;
+        for (auto i = 0; i != 100; ++i)
+            source += "void f" + std::to_string(i) + "();\n";
+        auto file = parse_file({}, "comment_registry.cpp", source.c_str());
+
+        std::vector<const cppast::cpp_entity*> entities;
+        for (auto& entity : *file)
+            entities.push_back(&entity);
+        REQUIRE(entities.size() == 100u);
+
+        auto register_comments = [&](comment_registry& registry, std::size_t begin,
+                                     std::size_t end, const std::string& prefix) {
+            for (auto i = begin; i != end; ++i)
+            {
+                comment::metadata data;
+                data.set_module(prefix + entities[i]->name());
+                REQUIRE(registry.register_comment(type_safe::ref(*entities[i]),
+                                                  comment::doc_comment(std::move(data), nullptr,
+                                                                       {})));
+            }
+        };
+        auto get_module = [](const comment_registry&   registry,
+                             const cppast::cpp_entity& entity) -> std::string {
+            auto result = registry.get_comment(entity);
+            REQUIRE(result);
+            REQUIRE(result.value().metadata().module());
+            return result.value().metadata().module().value();
+        };
+
+        // never registered in an empty registry
+        comment_registry a;
+        REQUIRE(!a.get_comment(*entities.front()));
+
+        // grows the table multiple times
+        register_comments(a, 0u, 60u, "a-");
+        auto first = &a.get_comment(*entities.front()).value();
+        register_comments(a, 60u, 70u, "a-");
+        REQUIRE(&a.get_comment(*entities.front()).value() == first);
+        for (auto i = 0u; i != 70u; ++i)
+            REQUIRE(get_module(a, *entities[i]) == "a-" + entities[i]->name());
+        // never registered
+        for (auto i = 70u; i != 100u; ++i)
+            REQUIRE(!a.get_comment(*entities[i]));
+        REQUIRE(!a.get_comment(*file));
+
+        // overlaps with the entities of a
+        comment_registry b;
+        register_comments(b, 50u, 90u, "b-");
+        a.add_to_group("g", type_safe::ref(*entities[0]));
+        b.add_to_group("g", type_safe::ref(*entities[1]));
+
+        a.merge(std::move(b));
+        REQUIRE(&a.get_comment(*entities.front()).value() == first);
+        for (auto i = 0u; i != 70u; ++i)
+            // the existing comment is kept
+            REQUIRE(get_module(a, *entities[i]) == "a-" + entities[i]->name());
+        for (auto i = 70u; i != 90u; ++i)
+            REQUIRE(get_module(a, *entities[i]) == "b-" + entities[i]->name());
+        for (auto i = 90u; i != 100u; ++i)
+            REQUIRE(!a.get_comment(*entities[i]));
+        REQUIRE((a.lookup_group("g").size() == 2u));
+
+        // merging into an empty registry takes over the table
+        comment_registry c;
+        c.merge(std::move(a));
+        REQUIRE(&c.get_comment(*entities.front()).value() == first);
+        REQUIRE(get_module(c, *entities[80]) == "b-" + entities[80]->name());
+        REQUIRE(!c.get_comment(*entities[95]));
+    }
+    SECTION("unique name table")
+    {
+        auto file = parse_file({}, "comment_unique_name_table.cpp", R"(
+namespace a
+{
+    namespace b
+    {
+        struct baz {};
+
+        /// \unique_name c
+        struct foo
+        {
+            /// \unique_name *bar
+            void f();
+
+            template <typename T>
+            void g(T t);
+        };
+    }
+}
+)");
+
+        auto              registry = parse_comments(*file);
+        unique_name_table names(registry);
+        REQUIRE(names.lookup(get_named_entity(*file, "baz")) == "a::b::baz");
+        REQUIRE(names.lookup(get_named_entity(*file, "foo")) == "c");
+        REQUIRE(names.lookup(get_named_entity(*file, "f")) == "c::bar");
+
+        cppast::visit(*file, [&](const cppast::cpp_entity& e, const cppast::visitor_info&) {
+            INFO(e.name());
+            REQUIRE(names.lookup(e) == lookup_unique_name(registry, e));
+            // the same reference every time
+            REQUIRE(&names.lookup(e) == &names.lookup(e));
+            return true;
+        });
+    }
     SECTION("module")
     {
         // set synopsis to same name as module
@@ -251,4 +393,54 @@ void a(float);
         REQUIRE(bar);
         REQUIRE(bar.value().metadata().synopsis() == "bar");
     }
+    SECTION("cache")
+    {
+        auto file = parse_file({}, "comment_cache.cpp", R"(
+/// \module a
+/// \param x
+/// \module x
+void f(int x);
+
+/// \module a
+/// \param x
+/// \module x
+void g(int x);
+
+/// \module a
+/// \param x
+/// \module x
+void h(int x);
+
+/// \module b
+using b = int;
+)");
+
+        // only kept once it is parsed the second time
+        file_comment_parser parser(test_logger());
+        parser.parse(type_safe::ref(*file));
+        REQUIRE(parser.cache_hits() == 1u);
+        REQUIRE(parser.cache_misses() == 3u);
+
+        file_comment_parser uncached(test_logger());
+        uncached.set_cache_limit(0u);
+        uncached.parse(type_safe::ref(*file));
+        REQUIRE(uncached.cache_hits() == 0u);
+        REQUIRE(uncached.cache_misses() == 4u);
+
+        auto comments = parser.finish();
+        for (auto name : {"f", "g", "h"})
+        {
+            auto& func = static_cast<const cppast::cpp_function_base&>(
+                get_named_entity(*file, name));
+            auto comment = comments.get_comment(func);
+            REQUIRE(comment);
+            REQUIRE(comment.value().metadata().module() == "a");
+
+            auto param = comments.get_comment(*func.parameters().begin());
+            REQUIRE(param);
+            REQUIRE(param.value().metadata().module() == "x");
+        }
+        REQUIRE(&comments.get_comment(get_named_entity(*file, "f")).value()
+                != &comments.get_comment(get_named_entity(*file, "g")).value());
+    }
 }
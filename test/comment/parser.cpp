@@ -4,6 +4,8 @@
 
 #include <standardese/comment/parser.hpp>
 
+#include <random>
+
 #include <catch.hpp>
 
 #include <standardese/markup/generator.hpp>
@@ -773,3 +775,142 @@ This is unrelated.
         REQUIRE(inlines[3].comment.metadata().module() == "d");
     }
 }
+
+TEST_CASE("thread parser", "[comment]")
+{
+    config default_config;
+    auto&  default_parser = get_thread_parser(default_config);
+    REQUIRE(&get_thread_parser(config()) == &default_parser);
+
+    config custom_config('@');
+    auto&  custom_parser = get_thread_parser(custom_config);
+    REQUIRE(&custom_parser != &default_parser);
+    REQUIRE(custom_parser.config().command_character() == '@');
+    REQUIRE(&get_thread_parser(default_config) == &default_parser);
+
+    // state must not leak from one comment into the next one
+    auto first = parse(default_config, "a\n\n\\effects b", true);
+    REQUIRE(first.comment.has_value());
+    REQUIRE(markup::as_xml(first.comment.value().brief_section().value())
+            == "<brief-section>a</brief-section>\n");
+    REQUIRE(first.comment.value().sections().size() == 1u);
+
+    auto second = parse(default_config, "c", true);
+    REQUIRE(second.comment.has_value());
+    REQUIRE(markup::as_xml(second.comment.value().brief_section().value())
+            == "<brief-section>c</brief-section>\n");
+    REQUIRE(second.comment.value().sections().empty());
+
+    auto custom = parse(custom_config, "@effects d", true);
+    REQUIRE(custom.comment.has_value());
+    REQUIRE(!custom.comment.value().brief_section());
+    REQUIRE(custom.comment.value().sections().size() == 1u);
+    REQUIRE(markup::as_xml(*custom.comment.value().sections().begin())
+            == "<inline-section name=\"Effects\">d</inline-section>\n");
+}
+
+TEST_CASE("command lookup", "[comment]")
+{
+    config c;
+    REQUIRE(c.try_lookup("effects") == unsigned(section_type::effects));
+    REQUIRE(c.try_lookup("effectsfoo", 7u) == unsigned(section_type::effects));
+    REQUIRE(c.try_lookup("effect") == unsigned(command_type::invalid));
+    REQUIRE(c.try_lookup("effectsfoo") == unsigned(command_type::invalid));
+    REQUIRE(c.try_lookup("exclude") == unsigned(command_type::exclude));
+
+    c.set_command_name(section_type::effects, "effect");
+    c.set_command_name(section_type::requires, "effects");
+    REQUIRE(c.try_lookup("effect") == unsigned(section_type::effects));
+    REQUIRE(c.try_lookup("effects") == unsigned(section_type::requires));
+    REQUIRE(c.try_lookup("requires") == unsigned(command_type::invalid));
+
+    // the first command wins for duplicate names
+    c.set_command_name(command_type::exclude, "effect");
+    REQUIRE(c.try_lookup("effect") == unsigned(section_type::effects));
+}
+
+// everything observable about the result of parsing a comment
+std::string describe(const parse_result& result)
+{
+    std::string description;
+    if (result.comment)
+    {
+        auto& comment = result.comment.value();
+        if (comment.brief_section())
+            description += markup::as_xml(comment.brief_section().value());
+        for (auto& section : comment.sections())
+            description += markup::as_xml(section);
+        if (!comment.metadata().is_empty())
+            description += "<metadata>\n";
+    }
+    else
+        description += "<no-comment>\n";
+
+    if (result.entity.has_value())
+        description += "<entity>\n";
+    description += std::to_string(result.inlines.size()) + " inlines\n";
+    return description;
+}
+
+template <typename Func>
+std::string describe_parse(Func f)
+{
+    try
+    {
+        return describe(f());
+    }
+    catch (parse_error& ex)
+    {
+        return std::string("error: ") + ex.what();
+    }
+}
+
+TEST_CASE("plain brief", "[comment]")
+{
+    parser p;
+    auto   check = [&](const std::string& comment) {
+        INFO('"' << comment << '"');
+        REQUIRE(describe_parse([&] { return parse(p, comment, true); })
+                == describe_parse([&] { return detail::parse_cmark(p, comment, true); }));
+    };
+
+    SECTION("plain")
+    {
+        for (auto comment : {"Does X.", "A", "Ends without punctuation", "Is it 2/3 = 0.66?",
+                             "Returns x, or y (if any) + 1: 42%!", "Semi; colon."})
+        {
+            REQUIRE(detail::is_plain_brief(p.config(), comment));
+            check(comment);
+        }
+    }
+    SECTION("not plain")
+    {
+        for (auto comment :
+             {"", " Leading space.", "Trailing space. ", "Two  spaces.", "Ellipsis...",
+              "1. A list", "Has `code`.", "Has *emphasis*.", "It's quoted.", "A -- dash.",
+              "Line\nbreak.", "Tab\tstop.", "Has \\effects command.", "Has <html>.",
+              "Has &amp; entity.", "Has [link]().", "#Heading", "Non-ASCII \xc3\xa4."})
+        {
+            REQUIRE(!detail::is_plain_brief(p.config(), comment));
+            check(comment);
+        }
+
+        config custom('x');
+        REQUIRE(!detail::is_plain_brief(custom, "Has the command character x."));
+    }
+    SECTION("random")
+    {
+        // both paths must agree on arbitrary comments
+        const char   alphabet[] = "aBz09 .,;:?!()/=%+-*_`'\"[]<>&#\n";
+        std::mt19937 generator(42u);
+        std::uniform_int_distribution<std::size_t> length(1u, 24u);
+        std::uniform_int_distribution<std::size_t> character(0u, sizeof(alphabet) - 2u);
+        for (auto i = 0; i != 2000; ++i)
+        {
+            std::string comment;
+            for (auto n = length(generator); n != 0u; --n)
+                comment += alphabet[character(generator)];
+            check(comment);
+        }
+    }
+}
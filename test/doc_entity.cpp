@@ -4,6 +4,9 @@
 
 #include <standardese/doc_entity.hpp>
 
+#include <cstdint>
+#include <thread>
+
 #include <catch.hpp>
 
 #include "test_parser.hpp"
@@ -257,3 +260,301 @@ file - doc_entity__base_inline
 )");
     }
 }
+
+// builds the file in a single pass and compares it with excluding and building separately
+void check_single_pass(const char* name, const char* source,
+                       const entity_blacklist& blacklist = {})
+{
+    cppast::cpp_entity_index two_pass_index;
+    comment_registry         two_pass_comments;
+    auto two_pass = build_doc_entities(two_pass_comments, two_pass_index, name, source, blacklist);
+
+    cppast::cpp_entity_index single_pass_index;
+    comment_registry         single_pass_comments;
+    auto                     file = parse_file(single_pass_index, name, source);
+    single_pass_comments.merge(parse_comments(*file));
+    auto output_name = file->name();
+    auto single_pass = build_doc_entities(type_safe::ref(single_pass_comments), single_pass_index,
+                                          blacklist, std::move(file), std::move(output_name));
+
+    REQUIRE(debug_string(*single_pass) == debug_string(*two_pass));
+}
+
+TEST_CASE("doc_entity single pass")
+{
+    SECTION("excluded")
+    {
+        check_single_pass("doc_entity_single_pass__excluded.hpp", R"(
+#define TEST_DOC_ENTITY_SINGLE_PASS__EXCLUDED_HPP_INCLUDED
+
+/// \exclude
+void a();
+
+class foo;
+
+/// \exclude
+namespace ns
+{
+   void b();
+}
+
+class foo
+{
+   void d();
+   virtual void e();
+
+   template <typename T>
+   void f(T t);
+
+public:
+   /// \exclude
+   friend void g() {}
+
+   friend void h() {}
+};
+
+/// \exclude
+template <typename T>
+struct bar
+{
+    void i();
+};
+
+using ns::b;
+)");
+    }
+    SECTION("blacklisted")
+    {
+        entity_blacklist blacklist;
+        blacklist.blacklist_namespace("outer::inner");
+
+        check_single_pass("doc_entity_single_pass__blacklisted.cpp", R"(
+namespace outer
+{
+    struct a {};
+
+    namespace inner
+    {
+         struct b {};
+    }
+
+    using inner::b;
+}
+)",
+                          blacklist);
+    }
+    SECTION("member groups")
+    {
+        check_single_pass("doc_entity_single_pass__member_groups.cpp", R"(
+struct foo
+{
+    /// \group a
+    void a();
+
+    /// \group b
+    void b();
+
+    /// \group a
+    void a(int i);
+
+private:
+    /// \group a
+    void a(float f);
+};
+)");
+    }
+    SECTION("bases")
+    {
+        check_single_pass("doc_entity_single_pass__bases.cpp", R"(
+/// \exclude
+struct base_base
+{
+    void a();
+};
+
+/// \exclude
+class base : public base_base
+{
+    void hidden();
+
+public:
+    void b();
+};
+
+/// \exclude
+struct hidden_base {};
+
+class foo
+: public base, private hidden_base
+{
+public:
+    void c();
+};
+)");
+    }
+    SECTION("other file")
+    {
+        // the base file is only excluded in the two pass version
+        auto build = [](bool single_pass) -> std::string {
+            cppast::cpp_entity_index index;
+            auto base = parse_file(index, "doc_entity_single_pass__base.hpp", R"(
+/// \exclude
+struct base
+{
+    void a();
+
+private:
+    void hidden();
+};
+
+namespace detail
+{
+    struct other {};
+}
+)");
+            auto file = parse_file(index, "doc_entity_single_pass__derived.cpp", R"(
+#include "doc_entity_single_pass__base.hpp"
+
+struct derived : base
+{
+    void b();
+};
+
+using detail::other;
+)");
+
+            comment_registry comments;
+            comments.merge(parse_comments(*base));
+            comments.merge(parse_comments(*file));
+
+            entity_blacklist blacklist;
+            blacklist.blacklist_namespace("detail");
+
+            if (single_pass)
+                return debug_string(*build_doc_entities(type_safe::ref(comments), index,
+                                                        blacklist, std::move(file), "derived"));
+
+            exclude_entities(comments, index, blacklist, *base);
+            exclude_entities(comments, index, blacklist, *file);
+            return debug_string(
+                *build_doc_entities(type_safe::ref(comments), index, std::move(file), "derived"));
+        };
+
+        REQUIRE(build(true) == build(false));
+    }
+}
+
+TEST_CASE("doc_entity_arena")
+{
+    std::vector<int> destroyed;
+    struct object
+    {
+        std::vector<int>* destroyed;
+        int               id;
+
+        ~object()
+        {
+            destroyed->push_back(id);
+        }
+    };
+
+    {
+        detail::doc_entity_arena arena;
+
+        auto& a = arena.create<object>(object{&destroyed, 1});
+        auto& b = arena.create<object>(object{&destroyed, 2});
+        REQUIRE(a.id == 1);
+        REQUIRE(b.id == 2);
+        destroyed.clear(); // the temporaries
+
+        for (auto size : {1u, 7u, 100u, 20000u})
+        {
+            auto ptr = arena.allocate(size);
+            REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignof(std::max_align_t) == 0u);
+        }
+    }
+    REQUIRE(destroyed == (std::vector<int>{2, 1}));
+}
+
+TEST_CASE("doc_entity concurrent build")
+{
+    // the members of the excluded base are injected into the derived class of another file,
+    // so the file of the base is built at the same time
+    auto build = [](bool concurrent) -> std::string {
+        cppast::cpp_entity_index index;
+        auto base = parse_file(index, "doc_entity_concurrent__base.hpp", R"(
+/// \exclude
+struct base
+{
+    void a();
+    void b();
+
+private:
+    void hidden();
+};
+
+void c();
+)");
+        auto derived = parse_file(index, "doc_entity_concurrent__derived.cpp", R"(
+#include "doc_entity_concurrent__base.hpp"
+
+struct derived : base
+{
+    void d();
+};
+)");
+
+        comment_registry comments;
+        comments.merge(parse_comments(*base));
+        comments.merge(parse_comments(*derived));
+
+        std::unique_ptr<doc_cpp_file> base_doc, derived_doc;
+        auto build_base = [&] {
+            base_doc =
+                build_doc_entities(type_safe::ref(comments), index, {}, std::move(base), "base");
+        };
+        auto build_derived = [&] {
+            derived_doc = build_doc_entities(type_safe::ref(comments), index, {},
+                                             std::move(derived), "derived");
+        };
+
+        if (concurrent)
+        {
+            std::thread building(build_base);
+            build_derived();
+            building.join();
+        }
+        else
+        {
+            build_base();
+            build_derived();
+        }
+
+        // the base isn't modified while building the derived class
+        for (auto name : {"a", "b"})
+        {
+            auto& member = get_named_entity(base_doc->file(), name);
+            REQUIRE(member.user_data());
+            REQUIRE(static_cast<const doc_entity*>(member.user_data())->is_excluded());
+        }
+
+        register_injected_entities(*base_doc);
+        register_injected_entities(*derived_doc);
+
+        // the inherited members refer to the doc entities of the derived class
+        for (auto name : {"a", "b"})
+        {
+            auto& member = get_named_entity(base_doc->file(), name);
+            REQUIRE(member.user_data());
+            auto& doc_member = *static_cast<const doc_entity*>(member.user_data());
+            REQUIRE(!doc_member.is_excluded());
+            REQUIRE(doc_member.is_injected());
+        }
+
+        return debug_string(*base_doc) + debug_string(*derived_doc);
+    };
+
+    auto expected = build(false);
+    for (auto i = 0; i != 8; ++i)
+        REQUIRE(build(true) == expected);
+}
@@ -4,6 +4,8 @@
 
 #include <standardese/doc_entity.hpp>
 
+#include <thread>
+
 #include <catch.hpp>
 
 #include <standardese/markup/document.hpp>
@@ -115,6 +117,127 @@ namespace ns
 </file-documentation>
 )*");
     }
+    SECTION("executor")
+    {
+        auto file = build_doc_entities(comments, index, "documentation__executor.cpp", R"(
+/// A.
+void a();
+
+namespace ns
+{
+    /// B.
+    void b();
+
+    /// C.
+    struct c {};
+}
+
+/// D.
+void d();
+)");
+
+        auto              no_tasks = 0u;
+        generation_config config;
+        config.set_executor([&](const std::vector<std::function<void()>>& tasks) {
+            // start them in reverse order, one thread each
+            std::vector<std::thread> threads;
+            for (auto iter = tasks.rbegin(); iter != tasks.rend(); ++iter)
+                threads.emplace_back(*iter);
+            for (auto& thread : threads)
+                thread.join();
+            no_tasks += unsigned(tasks.size());
+        });
+
+        auto expected = markup::as_xml(*generate_documentation({}, {}, index, *file));
+        auto doc      = generate_documentation(config, {}, index, *file);
+        REQUIRE(markup::as_xml(*doc) == expected);
+        REQUIRE(no_tasks == 5u); // the children of the file and the namespace
+    }
+    SECTION("pages")
+    {
+        auto file = build_doc_entities(comments, index, "documentation__pages.cpp", R"(
+/// A.
+void a();
+
+namespace ns
+{
+    /// B.
+    struct b
+    {
+        /// C.
+        void c();
+    };
+
+    /// D.
+    /// \output_section Section
+    void d();
+
+    /// E.
+    void e();
+
+    /// F.
+    class f {};
+}
+
+/// G.
+void g();
+)");
+
+        std::vector<documentation_page> pages;
+        auto doc = generate_documentation({}, {}, index, *file, pages);
+
+        // the namespace has no page, as everything is on the other ones
+        REQUIRE(pages.size() == 3u);
+        REQUIRE(pages[0].title == "ns::b");
+        REQUIRE(pages[0].name == "ns::b");
+        REQUIRE(pages[0].documentations.size() == 1u);
+        REQUIRE(pages[1].title == "Section");
+        REQUIRE(pages[1].name == "ns::d()");
+        REQUIRE(pages[1].documentations.size() == 2u);
+        REQUIRE(pages[2].title == "ns::f");
+        REQUIRE(pages[2].name == "ns::f");
+        REQUIRE(pages[2].documentations.size() == 1u);
+
+        std::vector<std::string> remaining;
+        for (auto& child : static_cast<const markup::file_documentation&>(*doc))
+            remaining.push_back(child.id().as_str());
+        REQUIRE(remaining == std::vector<std::string>{"a()", "g()"});
+
+        // the entities are registered for the page they are on
+        markup::subdocument::builder file_doc("file", "file");
+        file_doc.add_child(std::move(doc));
+
+        std::vector<std::unique_ptr<markup::document_entity>> documents;
+        documents.push_back(file_doc.finish());
+        for (auto& page : pages)
+        {
+            markup::subdocument::builder page_doc(page.title, "page_" + page.name);
+            for (auto& documentation : page.documentations)
+                page_doc.add_child(std::move(documentation));
+            documents.push_back(page_doc.finish());
+        }
+
+        linker l;
+        register_documentations(*test_logger(), l,
+                                std::vector<const markup::document_entity*>{documents[0].get(),
+                                                                            documents[1].get(),
+                                                                            documents[2].get(),
+                                                                            documents[3].get()});
+
+        auto get_document = [&](const char* link_name) -> std::string {
+            auto result = l.lookup_documentation(nullptr, link_name);
+            auto block  = result.optional_value(type_safe::variant_type<markup::block_reference>{});
+            REQUIRE(block);
+            return block.value().document().value().name();
+        };
+        REQUIRE(get_document("a()") == "file");
+        REQUIRE(get_document("ns::b") == "page_ns::b");
+        REQUIRE(get_document("ns::b::c()") == "page_ns::b");
+        REQUIRE(get_document("ns::d()") == "page_ns::d()");
+        REQUIRE(get_document("ns::e()") == "page_ns::d()");
+        REQUIRE(get_document("ns::f") == "page_ns::f");
+        REQUIRE(get_document("g()") == "file");
+    }
     SECTION("inlines")
     {
         auto file = build_doc_entities(comments, index, "documentation__inlines.cpp", R"(
@@ -404,6 +527,58 @@ void foo(int);
 </module-index>
 )*");
     }
+    SECTION("index entries")
+    {
+        auto file = build_doc_entities(comments, index, "documentation__index_entries.cpp", R"(
+/// \file
+/// brief
+
+/// \module foo
+/// brief
+
+/// brief
+/// \module foo
+void a();
+
+namespace ns
+{
+    /// brief
+    /// \module bar
+    void b();
+
+    namespace
+    {
+        void c();
+    }
+}
+)");
+
+        entity_index eindex;
+        file_index   findex;
+        module_index mindex;
+        register_index_entities(eindex, file->file());
+        register_module_entities(mindex, comments, file->file());
+        findex.register_file(file->link_name(), file->output_name(),
+                             file->comment().value().brief_section());
+
+        auto entity_xml = markup::as_xml(*eindex.generate(entity_index::order::namespace_external));
+        auto file_xml   = markup::as_xml(*findex.generate());
+        auto module_xml = markup::as_xml(*mindex.generate());
+
+        // the entries don't refer to the file
+        auto entries = get_index_entries(comments, *file);
+        file.reset();
+
+        entity_index entries_eindex;
+        file_index   entries_findex;
+        module_index entries_mindex;
+        register_index_entries(entries_eindex, entries_findex, entries_mindex, entries);
+
+        REQUIRE(markup::as_xml(*entries_eindex.generate(entity_index::order::namespace_external))
+                == entity_xml);
+        REQUIRE(markup::as_xml(*entries_findex.generate()) == file_xml);
+        REQUIRE(markup::as_xml(*entries_mindex.generate()) == module_xml);
+    }
     SECTION("linking")
     {
         auto target_file =
@@ -69,6 +69,22 @@ TEST_CASE("linker")
         REQUIRE(equal_destination(l.lookup_documentation(nullptr, "foo"), *document_b,
                                   markup::block_id("foo")));
     }
+    SECTION("block reference")
+    {
+        auto ref = markup::block_reference(document_b->output_name(), markup::block_id("bar"));
+        REQUIRE(l.register_documentation("foo", *document_a, markup::block_id("foo"), false));
+        REQUIRE(!l.register_documentation("foo", ref, false));
+        REQUIRE(l.register_documentation("bar()", ref, false));
+
+        REQUIRE(equal_destination(l.lookup_documentation(nullptr, "foo"), *document_a,
+                                  markup::block_id("foo")));
+        REQUIRE(equal_destination(l.lookup_documentation(nullptr, "bar"), *document_b,
+                                  markup::block_id("bar")));
+
+        REQUIRE(l.register_documentation("foo", ref, true));
+        REQUIRE(equal_destination(l.lookup_documentation(nullptr, "foo"), *document_b,
+                                  markup::block_id("bar")));
+    }
     SECTION("short and long link names")
     {
         REQUIRE(l.register_documentation("foo()", *document_a, markup::block_id("foo"), false));
@@ -146,6 +162,12 @@ void context3();
         auto& context3 = get_named_entity(*file, "context3");
         REQUIRE(equal_destination(l.lookup_documentation(type_safe::ref(context3), "*func"),
                                   *document_a, markup::block_id("func")));
+
+        // lookup with the scopes of a namespace only
+        REQUIRE(equal_destination(l.lookup_documentation({"ns::", ""}, "*func"), *document_a,
+                                  markup::block_id("ns::func")));
+        REQUIRE(equal_destination(l.lookup_documentation({""}, "*func"), *document_a,
+                                  markup::block_id("func")));
     }
     SECTION("external doc")
     {
@@ -0,0 +1,1215 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "cache.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <sstream>
+
+#include <cppast/cpp_preprocessor.hpp>
+
+#include <standardese/markup/code_block.hpp>
+#include <standardese/markup/doc_section.hpp>
+#include <standardese/markup/entity_kind.hpp>
+#include <standardese/markup/heading.hpp>
+#include <standardese/markup/link.hpp>
+#include <standardese/markup/list.hpp>
+#include <standardese/markup/paragraph.hpp>
+#include <standardese/markup/phrasing.hpp>
+#include <standardese/markup/quote.hpp>
+#include <standardese/markup/thematic_break.hpp>
+
+using namespace standardese_tool;
+namespace markup = standardese::markup;
+
+hasher& hasher::add(const void* data, std::size_t size) noexcept
+{
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (auto end = bytes + size; bytes != end; ++bytes)
+    {
+        value_ ^= *bytes;
+        value_ *= 1099511628211ull;
+    }
+    return *this;
+}
+
+hasher& hasher::add(std::uint64_t value) noexcept
+{
+    unsigned char bytes[8];
+    for (auto i = 0u; i != 8u; ++i)
+        bytes[i] = static_cast<unsigned char>(value >> (i * 8u));
+    return add(bytes, sizeof(bytes));
+}
+
+hasher& hasher::add(const std::string& str) noexcept
+{
+    add(std::uint64_t(str.size()));
+    return add(str.data(), str.size());
+}
+
+namespace
+{
+    // manifest format:
+    // magic, version, options fingerprint, outputs, records, index documents
+    // all integers are written as LEB128, strings and sequences are prefixed by their length,
+    // markup entities by their kind, the index entries use the same format
+    constexpr char          manifest_magic[] = "standardese-cache";
+    constexpr std::uint64_t manifest_version = 5u;
+
+    // where a documentation link points to
+    enum class link_destination : std::uint64_t
+    {
+        unresolved,
+        internal,
+        external,
+    };
+
+    class manifest_writer
+    {
+    public:
+        explicit manifest_writer(std::ostream& out) : out_(&out) {}
+
+        void write(std::uint64_t value)
+        {
+            do
+            {
+                auto byte = static_cast<unsigned char>(value & 0x7f);
+                value >>= 7;
+                if (value != 0u)
+                    byte |= 0x80;
+                out_->put(static_cast<char>(byte));
+            } while (value != 0u);
+        }
+
+        void write(const std::string& str)
+        {
+            write(std::uint64_t(str.size()));
+            out_->write(str.data(), static_cast<std::streamsize>(str.size()));
+        }
+
+        void write(const std::vector<std::string>& strs)
+        {
+            write(std::uint64_t(strs.size()));
+            for (auto& str : strs)
+                write(str);
+        }
+
+        void write(const document_record& record)
+        {
+            write(record.name);
+            write(std::uint64_t(record.registrations.size()));
+            for (auto& registration : record.registrations)
+            {
+                write(registration.link_name);
+                write(registration.id);
+                write(std::uint64_t(registration.force));
+            }
+            write(record.links);
+        }
+
+        void write(const file_record& record)
+        {
+            write(record.path);
+            write(record.key);
+            write(record.includes);
+            write(std::uint64_t(record.documents.size()));
+            for (auto& document : record.documents)
+                write(document);
+            write(record.index_entries);
+            write(record.modules);
+            write(std::uint64_t(record.has_remote_comments));
+            write(record.remote_targets);
+            write(record.parse_time);
+        }
+
+        // only the entities that can be part of a documentation comment are supported
+        void write(const markup::entity& entity)
+        {
+            write(std::uint64_t(entity.kind()));
+            switch (entity.kind())
+            {
+            case markup::entity_kind::heading:
+                write_block(static_cast<const markup::heading&>(entity));
+                break;
+            case markup::entity_kind::subheading:
+                write_block(static_cast<const markup::subheading&>(entity));
+                break;
+            case markup::entity_kind::paragraph:
+                write_block(static_cast<const markup::paragraph&>(entity));
+                break;
+            case markup::entity_kind::list_item:
+                write_block(static_cast<const markup::list_item&>(entity));
+                break;
+            case markup::entity_kind::unordered_list:
+                write_block(static_cast<const markup::unordered_list&>(entity));
+                break;
+            case markup::entity_kind::ordered_list:
+                write_block(static_cast<const markup::ordered_list&>(entity));
+                break;
+            case markup::entity_kind::block_quote:
+                write_block(static_cast<const markup::block_quote&>(entity));
+                break;
+
+            case markup::entity_kind::term:
+                write_children(static_cast<const markup::term&>(entity));
+                break;
+            case markup::entity_kind::description:
+                write_children(static_cast<const markup::description&>(entity));
+                break;
+            case markup::entity_kind::term_description_item:
+            {
+                auto& item = static_cast<const markup::term_description_item&>(entity);
+                write(item.id().as_str());
+                write(item.term());
+                write(item.description());
+                break;
+            }
+
+            case markup::entity_kind::code_block:
+            {
+                auto& code = static_cast<const markup::code_block&>(entity);
+                write(code.id().as_str());
+                write(code.language());
+                write_children(code);
+                break;
+            }
+            case markup::entity_kind::code_block_keyword:
+                write(static_cast<const markup::code_block::keyword&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_identifier:
+                write(static_cast<const markup::code_block::identifier&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_string_literal:
+                write(static_cast<const markup::code_block::string_literal&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_int_literal:
+                write(static_cast<const markup::code_block::int_literal&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_float_literal:
+                write(static_cast<const markup::code_block::float_literal&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_punctuation:
+                write(static_cast<const markup::code_block::punctuation&>(entity).string());
+                break;
+            case markup::entity_kind::code_block_preprocessor:
+                write(static_cast<const markup::code_block::preprocessor&>(entity).string());
+                break;
+
+            case markup::entity_kind::brief_section:
+                write_children(static_cast<const markup::brief_section&>(entity));
+                break;
+            case markup::entity_kind::details_section:
+                write_children(static_cast<const markup::details_section&>(entity));
+                break;
+            case markup::entity_kind::inline_section:
+            {
+                auto& section = static_cast<const markup::inline_section&>(entity);
+                write(std::uint64_t(section.type()));
+                write(section.name());
+                write_children(section);
+                break;
+            }
+            case markup::entity_kind::list_section:
+            {
+                auto& section = static_cast<const markup::list_section&>(entity);
+                write(std::uint64_t(section.type()));
+                write(section.name());
+                write(section.id().as_str());
+                write_children(section);
+                break;
+            }
+
+            case markup::entity_kind::thematic_break:
+            case markup::entity_kind::soft_break:
+            case markup::entity_kind::hard_break:
+                break;
+
+            case markup::entity_kind::text:
+                write(static_cast<const markup::text&>(entity).string());
+                break;
+            case markup::entity_kind::emphasis:
+                write_children(static_cast<const markup::emphasis&>(entity));
+                break;
+            case markup::entity_kind::strong_emphasis:
+                write_children(static_cast<const markup::strong_emphasis&>(entity));
+                break;
+            case markup::entity_kind::code:
+                write_children(static_cast<const markup::code&>(entity));
+                break;
+            case markup::entity_kind::verbatim:
+                write(static_cast<const markup::verbatim&>(entity).content());
+                break;
+
+            case markup::entity_kind::external_link:
+            {
+                auto& link = static_cast<const markup::external_link&>(entity);
+                write(link.title());
+                write(link.url().as_str());
+                write_children(link);
+                break;
+            }
+            case markup::entity_kind::documentation_link:
+                write(static_cast<const markup::documentation_link&>(entity));
+                break;
+
+            default:
+                assert(false);
+                break;
+            }
+        }
+
+        void write(const standardese::index_entries& entries)
+        {
+            write(std::uint64_t(entries.entities.size()));
+            for (auto& entry : entries.entities)
+                write(entry);
+            write(std::uint64_t(entries.namespaces.size()));
+            for (auto& entry : entries.namespaces)
+            {
+                write(entry.name);
+                write(entry.scope);
+                write(entry.doc->scope());
+                write_documentation(*entry.doc);
+            }
+            write(std::uint64_t(entries.modules.size()));
+            for (auto& module : entries.modules)
+                write_documentation(*module);
+            write(std::uint64_t(entries.module_entities.size()));
+            for (auto& entry : entries.module_entities)
+            {
+                write(entry.module);
+                write(entry.link_name);
+                write(entry.name);
+                write_brief(entry.brief);
+            }
+            write(entries.file);
+        }
+
+    private:
+        template <typename T>
+        void write_children(const T& container)
+        {
+            auto size = std::uint64_t(0);
+            for (auto iter = container.begin(); iter != container.end(); ++iter)
+                ++size;
+            write(size);
+            for (auto& child : container)
+                write(child);
+        }
+
+        template <typename T>
+        void write_block(const T& block)
+        {
+            write(block.id().as_str());
+            write_children(block);
+        }
+
+        void write(const markup::documentation_link& link)
+        {
+            write(link.title());
+            if (auto dest = link.unresolved_destination())
+            {
+                write(std::uint64_t(link_destination::unresolved));
+                write(dest.value());
+            }
+            else if (auto ref = link.internal_destination())
+            {
+                auto& document = ref.value().document();
+                write(std::uint64_t(link_destination::internal));
+                write(std::uint64_t(document.has_value()));
+                if (document)
+                {
+                    write(document.value().name());
+                    write(std::uint64_t(document.value().needs_extension()));
+                }
+                write(ref.value().id().as_str());
+            }
+            else
+            {
+                write(std::uint64_t(link_destination::external));
+                write(link.external_destination().value().as_str());
+            }
+            write_children(link);
+        }
+
+        template <class Documentation>
+        void write_documentation(const Documentation& doc)
+        {
+            write(doc.id().as_str());
+            write(std::uint64_t(doc.header().has_value()));
+            if (doc.header())
+            {
+                auto& module = doc.header().value().module();
+                write(doc.header().value().heading());
+                write(std::uint64_t(module.has_value()));
+                if (module)
+                    write(module.value());
+            }
+
+            auto size = std::uint64_t(0);
+            for (auto iter = doc.doc_sections().begin(); iter != doc.doc_sections().end(); ++iter)
+                ++size;
+            write(size);
+            for (auto& section : doc.doc_sections())
+                write(section);
+        }
+
+        void write_brief(const std::unique_ptr<markup::brief_section>& brief)
+        {
+            write(std::uint64_t(brief != nullptr));
+            if (brief)
+                write(*brief);
+        }
+
+        void write(const standardese::index_entries::entity_entry& entry)
+        {
+            write(entry.link_name);
+            write(entry.name);
+            write(entry.scope);
+            write_brief(entry.brief);
+        }
+
+        std::ostream* out_;
+    };
+
+    // whether or not an entity of the given kind has the type of the pointer
+    bool is_a(markup::entity_kind kind, const markup::phrasing_entity*)
+    {
+        return markup::is_phrasing(kind);
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::block_entity*)
+    {
+        return markup::is_block(kind);
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::list_item_base*)
+    {
+        return kind == markup::entity_kind::list_item
+               || kind == markup::entity_kind::term_description_item;
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::doc_section*)
+    {
+        return kind == markup::entity_kind::brief_section
+               || kind == markup::entity_kind::details_section
+               || kind == markup::entity_kind::inline_section
+               || kind == markup::entity_kind::list_section;
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::heading*)
+    {
+        return kind == markup::entity_kind::heading;
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::term*)
+    {
+        return kind == markup::entity_kind::term;
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::description*)
+    {
+        return kind == markup::entity_kind::description;
+    }
+
+    bool is_a(markup::entity_kind kind, const markup::brief_section*)
+    {
+        return kind == markup::entity_kind::brief_section;
+    }
+
+    class manifest_reader
+    {
+    public:
+        explicit manifest_reader(std::istream& in) : in_(&in) {}
+
+        bool read(std::uint64_t& value)
+        {
+            value = 0u;
+            for (auto shift = 0u; shift < 64u; shift += 7u)
+            {
+                auto c = in_->get();
+                if (c == std::char_traits<char>::eof())
+                    return false;
+
+                auto byte = static_cast<std::uint64_t>(c);
+                value |= (byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0u)
+                    return true;
+            }
+            return false;
+        }
+
+        bool read(std::string& str)
+        {
+            std::uint64_t size;
+            if (!read(size))
+                return false;
+
+            str.resize(static_cast<std::size_t>(size));
+            if (size != 0u)
+                in_->read(&str[0], static_cast<std::streamsize>(size));
+            return static_cast<bool>(*in_);
+        }
+
+        bool read(bool& value)
+        {
+            std::uint64_t integer;
+            if (!read(integer))
+                return false;
+            value = integer != 0u;
+            return true;
+        }
+
+        template <typename T>
+        bool read(std::vector<T>& values)
+        {
+            std::uint64_t size;
+            if (!read(size))
+                return false;
+
+            values.resize(static_cast<std::size_t>(size));
+            for (auto& value : values)
+                if (!read(value))
+                    return false;
+            return true;
+        }
+
+        bool read(registration_record& record)
+        {
+            return read(record.link_name) && read(record.id) && read(record.force);
+        }
+
+        bool read(document_record& record)
+        {
+            return read(record.name) && read(record.registrations) && read(record.links);
+        }
+
+        bool read(file_record& record)
+        {
+            return read(record.path) && read(record.key) && read(record.includes)
+                   && read(record.documents) && read(record.index_entries)
+                   && read(record.modules) && read(record.has_remote_comments)
+                   && read(record.remote_targets) && read(record.parse_time);
+        }
+
+        bool read(std::unique_ptr<markup::entity>& result)
+        {
+            std::uint64_t kind;
+            if (!read(kind))
+                return false;
+
+            switch (static_cast<markup::entity_kind>(kind))
+            {
+            case markup::entity_kind::heading:
+                return read_block<markup::heading, markup::phrasing_entity>(result);
+            case markup::entity_kind::subheading:
+                return read_block<markup::subheading, markup::phrasing_entity>(result);
+            case markup::entity_kind::paragraph:
+                return read_block<markup::paragraph, markup::phrasing_entity>(result);
+            case markup::entity_kind::list_item:
+                return read_block<markup::list_item, markup::block_entity>(result);
+            case markup::entity_kind::unordered_list:
+                return read_list<markup::unordered_list>(result);
+            case markup::entity_kind::ordered_list:
+                return read_list<markup::ordered_list>(result);
+            case markup::entity_kind::block_quote:
+                return read_block<markup::block_quote, markup::block_entity>(result);
+
+            case markup::entity_kind::term:
+                return read_container<markup::term, markup::phrasing_entity>(result);
+            case markup::entity_kind::description:
+                return read_container<markup::description, markup::phrasing_entity>(result);
+            case markup::entity_kind::term_description_item:
+            {
+                std::string                          id;
+                std::unique_ptr<markup::term>        term;
+                std::unique_ptr<markup::description> description;
+                if (!read(id) || !read(term) || !read(description))
+                    return false;
+                result = markup::term_description_item::build(markup::block_id(std::move(id)),
+                                                              std::move(term),
+                                                              std::move(description));
+                return true;
+            }
+
+            case markup::entity_kind::code_block:
+            {
+                std::string id, language;
+                if (!read(id) || !read(language))
+                    return false;
+                markup::code_block::builder builder(markup::block_id(std::move(id)),
+                                                    std::move(language));
+                if (!read_children<markup::phrasing_entity>(
+                        [&](std::unique_ptr<markup::phrasing_entity> child) {
+                            builder.add_child(std::move(child));
+                        }))
+                    return false;
+                result = builder.finish();
+                return true;
+            }
+            case markup::entity_kind::code_block_keyword:
+                return read_string_entity<markup::code_block::keyword>(result);
+            case markup::entity_kind::code_block_identifier:
+                return read_string_entity<markup::code_block::identifier>(result);
+            case markup::entity_kind::code_block_string_literal:
+                return read_string_entity<markup::code_block::string_literal>(result);
+            case markup::entity_kind::code_block_int_literal:
+                return read_string_entity<markup::code_block::int_literal>(result);
+            case markup::entity_kind::code_block_float_literal:
+                return read_string_entity<markup::code_block::float_literal>(result);
+            case markup::entity_kind::code_block_punctuation:
+                return read_string_entity<markup::code_block::punctuation>(result);
+            case markup::entity_kind::code_block_preprocessor:
+                return read_string_entity<markup::code_block::preprocessor>(result);
+
+            case markup::entity_kind::brief_section:
+                return read_container<markup::brief_section, markup::phrasing_entity>(result);
+            case markup::entity_kind::details_section:
+                return read_container<markup::details_section, markup::block_entity>(result);
+            case markup::entity_kind::inline_section:
+            {
+                markup::section_type type;
+                std::string          name;
+                if (!read(type) || !read(name))
+                    return false;
+                markup::inline_section::builder builder(type, std::move(name));
+                if (!read_children<markup::phrasing_entity>(
+                        [&](std::unique_ptr<markup::phrasing_entity> child) {
+                            builder.add_child(std::move(child));
+                        }))
+                    return false;
+                result = builder.finish();
+                return true;
+            }
+            case markup::entity_kind::list_section:
+            {
+                markup::section_type type;
+                std::string          name;
+                std::unique_ptr<markup::entity> list;
+                if (!read(type) || !read(name) || !read_list<markup::unordered_list>(list))
+                    return false;
+                result = markup::list_section::build(type, std::move(name),
+                                                     std::unique_ptr<markup::unordered_list>(
+                                                         static_cast<markup::unordered_list*>(
+                                                             list.release())));
+                return true;
+            }
+
+            case markup::entity_kind::thematic_break:
+                result = markup::thematic_break::build();
+                return true;
+            case markup::entity_kind::soft_break:
+                result = markup::soft_break::build();
+                return true;
+            case markup::entity_kind::hard_break:
+                result = markup::hard_break::build();
+                return true;
+
+            case markup::entity_kind::text:
+                return read_string_entity<markup::text>(result);
+            case markup::entity_kind::emphasis:
+                return read_container<markup::emphasis, markup::phrasing_entity>(result);
+            case markup::entity_kind::strong_emphasis:
+                return read_container<markup::strong_emphasis, markup::phrasing_entity>(result);
+            case markup::entity_kind::code:
+                return read_container<markup::code, markup::phrasing_entity>(result);
+            case markup::entity_kind::verbatim:
+                return read_string_entity<markup::verbatim>(result);
+
+            case markup::entity_kind::external_link:
+            {
+                std::string title, url;
+                if (!read(title) || !read(url))
+                    return false;
+                markup::external_link::builder builder(std::move(title),
+                                                       markup::url(std::move(url)));
+                if (!read_children<markup::phrasing_entity>(
+                        [&](std::unique_ptr<markup::phrasing_entity> child) {
+                            builder.add_child(std::move(child));
+                        }))
+                    return false;
+                result = builder.finish();
+                return true;
+            }
+            case markup::entity_kind::documentation_link:
+                return read_documentation_link(result);
+
+            default:
+                return false;
+            }
+        }
+
+        // reads an entity of the given type
+        template <typename T>
+        bool read(std::unique_ptr<T>& result)
+        {
+            std::unique_ptr<markup::entity> entity;
+            if (!read(entity) || !is_a(entity->kind(), static_cast<T*>(nullptr)))
+                return false;
+            result.reset(static_cast<T*>(entity.release()));
+            return true;
+        }
+
+        bool read(standardese::index_entries& entries)
+        {
+            std::uint64_t size;
+            if (!read(size))
+                return false;
+            entries.entities.resize(static_cast<std::size_t>(size));
+            for (auto& entry : entries.entities)
+                if (!read(entry))
+                    return false;
+
+            if (!read(size))
+                return false;
+            for (auto i = std::uint64_t(0); i != size; ++i)
+            {
+                standardese::index_entries::namespace_entry entry;
+                std::string                                 doc_scope;
+                if (!read(entry.name) || !read(entry.scope) || !read(doc_scope))
+                    return false;
+
+                std::string                                       id;
+                type_safe::optional<markup::documentation_header> header;
+                if (!read(id) || !read(header))
+                    return false;
+                markup::namespace_documentation::builder builder(doc_scope,
+                                                                 markup::block_id(std::move(id)),
+                                                                 std::move(header));
+                if (!read_sections(builder))
+                    return false;
+                entry.doc = builder.finish();
+                entries.namespaces.push_back(std::move(entry));
+            }
+
+            if (!read(size))
+                return false;
+            for (auto i = std::uint64_t(0); i != size; ++i)
+            {
+                std::string                                       id;
+                type_safe::optional<markup::documentation_header> header;
+                if (!read(id) || !read(header))
+                    return false;
+                markup::module_documentation::builder builder(markup::block_id(std::move(id)),
+                                                              std::move(header));
+                if (!read_sections(builder))
+                    return false;
+                entries.modules.push_back(builder.finish());
+            }
+
+            if (!read(size))
+                return false;
+            entries.module_entities.resize(static_cast<std::size_t>(size));
+            for (auto& entry : entries.module_entities)
+                if (!read(entry.module) || !read(entry.link_name) || !read(entry.name)
+                    || !read_brief(entry.brief))
+                    return false;
+
+            return read(entries.file);
+        }
+
+    private:
+        bool read(markup::section_type& type)
+        {
+            std::uint64_t value;
+            if (!read(value) || value >= std::uint64_t(markup::section_type::count))
+                return false;
+            type = static_cast<markup::section_type>(value);
+            return true;
+        }
+
+        bool read(type_safe::optional<markup::documentation_header>& header)
+        {
+            bool has_header;
+            if (!read(has_header))
+                return false;
+            else if (!has_header)
+                return true;
+
+            std::unique_ptr<markup::heading> heading;
+            bool                             has_module;
+            std::string                      module;
+            if (!read(heading) || !read(has_module) || (has_module && !read(module)))
+                return false;
+            header.emplace(std::move(heading), has_module ?
+                                                   type_safe::make_optional(std::move(module)) :
+                                                   type_safe::nullopt);
+            return true;
+        }
+
+        bool read_brief(std::unique_ptr<markup::brief_section>& brief)
+        {
+            bool has_brief;
+            return read(has_brief) && (!has_brief || read(brief));
+        }
+
+        bool read(standardese::index_entries::entity_entry& entry)
+        {
+            return read(entry.link_name) && read(entry.name) && read(entry.scope)
+                   && read_brief(entry.brief);
+        }
+
+        // calls the function with each child
+        template <typename T, typename Func>
+        bool read_children(Func add_child)
+        {
+            std::uint64_t size;
+            if (!read(size))
+                return false;
+            for (auto i = std::uint64_t(0); i != size; ++i)
+            {
+                std::unique_ptr<T> child;
+                if (!read(child))
+                    return false;
+                add_child(std::move(child));
+            }
+            return true;
+        }
+
+        template <class Container, typename Child>
+        bool read_container(std::unique_ptr<markup::entity>& result)
+        {
+            typename Container::builder builder;
+            if (!read_children<Child>(
+                    [&](std::unique_ptr<Child> child) { builder.add_child(std::move(child)); }))
+                return false;
+            result = builder.finish();
+            return true;
+        }
+
+        template <class Block, typename Child>
+        bool read_block(std::unique_ptr<markup::entity>& result)
+        {
+            std::string id;
+            if (!read(id))
+                return false;
+            typename Block::builder builder(markup::block_id(std::move(id)));
+            if (!read_children<Child>(
+                    [&](std::unique_ptr<Child> child) { builder.add_child(std::move(child)); }))
+                return false;
+            result = builder.finish();
+            return true;
+        }
+
+        template <class List>
+        bool read_list(std::unique_ptr<markup::entity>& result)
+        {
+            std::string id;
+            if (!read(id))
+                return false;
+            typename List::builder builder(markup::block_id(std::move(id)));
+            if (!read_children<markup::list_item_base>(
+                    [&](std::unique_ptr<markup::list_item_base> item) {
+                        builder.add_item(std::move(item));
+                    }))
+                return false;
+            result = builder.finish();
+            return true;
+        }
+
+        template <class T>
+        bool read_string_entity(std::unique_ptr<markup::entity>& result)
+        {
+            std::string str;
+            if (!read(str))
+                return false;
+            result = T::build(std::move(str));
+            return true;
+        }
+
+        bool read_documentation_link(std::unique_ptr<markup::entity>& result)
+        {
+            std::string   title;
+            std::uint64_t destination;
+            if (!read(title) || !read(destination))
+                return false;
+
+            std::unique_ptr<markup::documentation_link::builder> builder;
+            type_safe::optional<markup::url>                     url;
+            switch (static_cast<link_destination>(destination))
+            {
+            case link_destination::unresolved:
+            {
+                std::string dest;
+                if (!read(dest))
+                    return false;
+                builder.reset(
+                    new markup::documentation_link::builder(std::move(title), std::move(dest)));
+                break;
+            }
+            case link_destination::internal:
+            {
+                bool        has_document, needs_extension = false;
+                std::string document, id;
+                if (!read(has_document)
+                    || (has_document && (!read(document) || !read(needs_extension)))
+                    || !read(id))
+                    return false;
+
+                auto ref =
+                    has_document ?
+                        markup::block_reference(needs_extension ?
+                                                    markup::output_name::from_name(document) :
+                                                    markup::output_name::from_file_name(document),
+                                                markup::block_id(std::move(id))) :
+                        markup::block_reference(markup::block_id(std::move(id)));
+                builder.reset(new markup::documentation_link::builder(std::move(title),
+                                                                      std::move(ref)));
+                break;
+            }
+            case link_destination::external:
+            {
+                std::string dest;
+                if (!read(dest))
+                    return false;
+                url.emplace(std::move(dest));
+                builder.reset(new markup::documentation_link::builder(std::move(title), ""));
+                break;
+            }
+            default:
+                return false;
+            }
+
+            if (!read_children<markup::phrasing_entity>(
+                    [&](std::unique_ptr<markup::phrasing_entity> child) {
+                        builder->add_child(std::move(child));
+                    }))
+                return false;
+
+            auto link = builder->finish();
+            if (url)
+                link->resolve_destination(url.value());
+            result = std::move(link);
+            return true;
+        }
+
+        // adds the sections to the builder of a documentation
+        template <class Builder>
+        bool read_sections(Builder& builder)
+        {
+            return read_children<markup::doc_section>(
+                [&](std::unique_ptr<markup::doc_section> section) {
+                    auto ptr = section.release();
+                    if (ptr->kind() == markup::entity_kind::brief_section)
+                        builder.add_brief(std::unique_ptr<markup::brief_section>(
+                            static_cast<markup::brief_section*>(ptr)));
+                    else if (ptr->kind() == markup::entity_kind::details_section)
+                        builder.add_details(std::unique_ptr<markup::details_section>(
+                            static_cast<markup::details_section*>(ptr)));
+                    else if (ptr->kind() == markup::entity_kind::inline_section)
+                        builder.add_section(std::unique_ptr<markup::inline_section>(
+                            static_cast<markup::inline_section*>(ptr)));
+                    else
+                        builder.add_section(std::unique_ptr<markup::list_section>(
+                            static_cast<markup::list_section*>(ptr)));
+                });
+        }
+
+        std::istream* in_;
+    };
+
+    fs::path get_manifest_path(const fs::path& directory)
+    {
+        return directory / "manifest";
+    }
+} // namespace
+
+bool cache::load()
+{
+    clear();
+    if (directory_.empty())
+        return false;
+
+    std::ifstream in(get_manifest_path(directory_).string(), std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    manifest_reader reader(in);
+
+    std::string   magic;
+    std::uint64_t version;
+    if (!reader.read(magic) || magic != manifest_magic || !reader.read(version)
+        || version != manifest_version)
+        return false;
+
+    std::uint64_t no_records;
+    if (!reader.read(options_) || !reader.read(outputs_) || !reader.read(no_records))
+    {
+        clear();
+        return false;
+    }
+
+    for (auto i = std::uint64_t(0); i != no_records; ++i)
+    {
+        file_record record;
+        if (!reader.read(record))
+        {
+            clear();
+            return false;
+        }
+        add_record(std::move(record));
+    }
+
+    if (!reader.read(index_documents_))
+    {
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+void cache::save() const
+{
+    if (directory_.empty())
+        return;
+    fs::create_directories(directory_);
+
+    // write to a temporary file first, so an interrupted run doesn't leave a broken manifest
+    auto path     = get_manifest_path(directory_);
+    auto tmp_path = fs::path(path).replace_extension(".tmp");
+    {
+        std::ofstream out(tmp_path.string(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            throw std::runtime_error("unable to write cache manifest '" + tmp_path.generic_string()
+                                     + "'");
+
+        manifest_writer writer(out);
+        writer.write(manifest_magic);
+        writer.write(manifest_version);
+        writer.write(options_);
+        writer.write(outputs_);
+        writer.write(std::uint64_t(records_.size()));
+        for (auto& pair : records_)
+            writer.write(pair.second);
+        writer.write(std::uint64_t(index_documents_.size()));
+        for (auto& document : index_documents_)
+            writer.write(document);
+    }
+    fs::rename(tmp_path, path);
+}
+
+void cache::clear() noexcept
+{
+    records_.clear();
+    index_documents_.clear();
+    outputs_.clear();
+    options_ = 0u;
+}
+
+const file_record* cache::lookup(const std::string& path) const noexcept
+{
+    auto iter = records_.find(path);
+    return iter == records_.end() ? nullptr : &iter->second;
+}
+
+void cache::add_record(file_record record)
+{
+    auto path      = record.path;
+    records_[path] = std::move(record);
+}
+
+std::string standardese_tool::write_index_entries(const standardese::index_entries& entries)
+{
+    std::ostringstream out;
+    manifest_writer    writer(out);
+    writer.write(entries);
+    return out.str();
+}
+
+standardese::index_entries standardese_tool::read_index_entries(const std::string& str)
+{
+    std::istringstream in(str);
+    manifest_reader    reader(in);
+
+    standardese::index_entries result;
+    if (!reader.read(result) || in.peek() != std::char_traits<char>::eof())
+        throw std::runtime_error("invalid index entries in cache manifest");
+    return result;
+}
+
+namespace
+{
+    std::vector<std::string> get_include_dirs(const std::vector<std::string>& flags)
+    {
+        std::vector<std::string> result;
+        for (auto iter = flags.begin(); iter != flags.end(); ++iter)
+        {
+            for (auto prefix : {"-I", "-isystem"})
+            {
+                auto length = std::strlen(prefix);
+                if (iter->compare(0, length, prefix) != 0)
+                    continue;
+                else if (iter->size() > length)
+                    result.push_back(iter->substr(length));
+                else if (std::next(iter) != flags.end())
+                    result.push_back(*++iter);
+                break;
+            }
+        }
+        return result;
+    }
+
+    // returns the header names of all #include directives in the file
+    // this is only an approximation, but good enough to detect changes in headers
+    std::vector<std::pair<std::string, bool>> scan_includes(const std::string& path)
+    {
+        std::vector<std::pair<std::string, bool>> result;
+
+        std::ifstream in(path);
+        std::string   line;
+        while (std::getline(in, line))
+        {
+            auto cur = line.c_str();
+            while (*cur == ' ' || *cur == '\t')
+                ++cur;
+            if (*cur != '#')
+                continue;
+            ++cur;
+            while (*cur == ' ' || *cur == '\t')
+                ++cur;
+            if (std::strncmp(cur, "include", 7u) != 0)
+                continue;
+            cur += 7;
+            while (*cur == ' ' || *cur == '\t')
+                ++cur;
+
+            auto is_quoted = *cur == '"';
+            if (!is_quoted && *cur != '<')
+                continue;
+            auto end = std::strchr(cur + 1, is_quoted ? '"' : '>');
+            if (end)
+                result.emplace_back(std::string(cur + 1, end), is_quoted);
+        }
+
+        return result;
+    }
+} // namespace
+
+std::uint64_t key_calculator::get_key(const std::string&              path,
+                                      const std::vector<std::string>& flags)
+{
+    hasher h;
+    for (auto& flag : flags)
+        h.add(flag);
+    for (auto& file : get_closure(path, flags))
+        h.add(file).add(get_content_hash(file));
+    return h.value();
+}
+
+std::uint64_t key_calculator::get_source_size(const std::string&              path,
+                                              const std::vector<std::string>& flags)
+{
+    std::uint64_t result = 0u;
+    for (auto& file : get_closure(path, flags))
+    {
+        auto iter = file_sizes_.find(file);
+        if (iter == file_sizes_.end())
+        {
+            boost::system::error_code ec;
+            auto                      size = fs::file_size(file, ec);
+            iter = file_sizes_.emplace(file, ec ? 0u : static_cast<std::uint64_t>(size)).first;
+        }
+        result += iter->second;
+    }
+    return result;
+}
+
+std::set<std::string> key_calculator::get_closure(const std::string&              path,
+                                                  const std::vector<std::string>& flags)
+{
+    auto include_dirs = get_include_dirs(flags);
+
+    std::set<std::string>    result;
+    std::vector<std::string> stack{path};
+    while (!stack.empty())
+    {
+        auto cur = std::move(stack.back());
+        stack.pop_back();
+        if (!result.insert(cur).second)
+            continue;
+
+        for (auto& include : get_direct_includes(cur, include_dirs))
+            if (!result.count(include))
+                stack.push_back(include);
+    }
+    return result;
+}
+
+std::uint64_t key_calculator::get_content_hash(const std::string& path)
+{
+    auto iter = content_hashes_.find(path);
+    if (iter != content_hashes_.end())
+        return iter->second;
+
+    hasher        h;
+    std::ifstream in(path, std::ios::binary);
+    if (in.is_open())
+    {
+        char buffer[4096];
+        while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+            h.add(buffer, static_cast<std::size_t>(in.gcount()));
+    }
+    else
+        // hash of missing file, must differ from the hash of an empty file
+        h.add(std::uint64_t(-1));
+
+    return content_hashes_.emplace(path, h.value()).first->second;
+}
+
+std::vector<std::string> key_calculator::get_includes(const std::string&              path,
+                                                      const std::vector<std::string>& flags)
+{
+    return get_direct_includes(path, get_include_dirs(flags));
+}
+
+const std::vector<std::string>& key_calculator::get_direct_includes(
+    const std::string& path, const std::vector<std::string>& include_dirs)
+{
+    auto record = records_->find(path);
+    if (record != records_->end())
+        return record->second.includes;
+
+    auto iter = scanned_includes_.find(path);
+    if (iter != scanned_includes_.end())
+        return iter->second;
+
+    std::vector<std::string> result;
+    for (auto& include : scan_includes(path))
+    {
+        auto resolve = [&](const fs::path& dir) {
+            auto candidate = dir / include.first;
+            if (!fs::is_regular_file(candidate))
+                return false;
+            result.push_back(fs::canonical(candidate).generic_string());
+            return true;
+        };
+
+        if (include.second && resolve(fs::path(path).parent_path()))
+            continue;
+        for (auto& dir : include_dirs)
+            if (resolve(dir))
+                break;
+        // otherwise a system header that isn't tracked
+    }
+
+    return scanned_includes_.emplace(path, std::move(result)).first->second;
+}
+
+std::vector<std::string> standardese_tool::get_includes(const cppast::cpp_file& file)
+{
+    std::vector<std::string> result;
+    for (auto& child : file)
+        if (child.kind() == cppast::cpp_entity_kind::include_directive_t)
+        {
+            fs::path path = static_cast<const cppast::cpp_include_directive&>(child).full_path();
+            result.push_back(fs::exists(path) ? fs::canonical(path).generic_string() :
+                                                path.generic_string());
+        }
+    return result;
+}
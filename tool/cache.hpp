@@ -0,0 +1,212 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef STANDARDESE_TOOL_CACHE_HPP_INCLUDED
+#define STANDARDESE_TOOL_CACHE_HPP_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <cppast/cpp_file.hpp>
+
+#include <standardese/index.hpp>
+
+#include "filesystem.hpp"
+
+namespace standardese_tool
+{
+    /// A 64bit FNV-1a hash.
+    class hasher
+    {
+    public:
+        hasher() noexcept : value_(14695981039346656037ull) {}
+
+        hasher& add(const void* data, std::size_t size) noexcept;
+
+        hasher& add(std::uint64_t value) noexcept;
+
+        /// \effects Adds the size followed by the characters,
+        /// so that a sequence of strings has a unique hash.
+        hasher& add(const std::string& str) noexcept;
+
+        std::uint64_t value() const noexcept
+        {
+            return value_;
+        }
+
+    private:
+        std::uint64_t value_;
+    };
+
+    /// A link name registered for a document.
+    struct registration_record
+    {
+        std::string link_name;
+        std::string id; //< id of the documentation block
+        bool        force;
+    };
+
+    /// The information about an output document from a previous run.
+    struct document_record
+    {
+        std::string                      name;          //< output name of the document
+        std::vector<registration_record> registrations; //< link names registered for it
+        std::vector<std::string>         links;         //< link names used in it
+    };
+
+    /// The information about an input file from a previous run.
+    struct file_record
+    {
+        std::string                  path; //< canonical path of the input file
+        std::uint64_t                key;  //< hash of the file, its flags and all included files
+        std::vector<std::string>     includes;  //< full paths of the files it includes
+        std::vector<document_record> documents; //< the documents generated for it, pages last
+        std::string                  index_entries; //< serialized entries of the index documents
+        std::vector<std::string>     modules;       //< modules of its entities
+        bool                         has_remote_comments; //< whether it has remote/module comments
+        std::vector<std::string>     remote_targets; //< entities and modules documented by them
+        std::uint64_t                parse_time;     //< microseconds needed to parse it
+    };
+
+    /// \returns The serialized form of the index entries of a file,
+    /// as stored in its [standardese_tool::file_record]().
+    std::string write_index_entries(const standardese::index_entries& entries);
+
+    /// \returns The index entries given their serialized form.
+    /// \throws `std::runtime_error` if it is invalid.
+    standardese::index_entries read_index_entries(const std::string& str);
+
+    /// The state of a previous run stored in the cache directory.
+    class cache
+    {
+    public:
+        /// \effects Creates a cache that is only kept in memory.
+        cache() : options_(0u) {}
+
+        /// \effects Creates a cache that is stored in the given directory.
+        explicit cache(fs::path directory) : directory_(std::move(directory)), options_(0u) {}
+
+        /// \effects Reads the manifest from the cache directory.
+        /// \returns Whether or not there was a valid manifest.
+        /// If there was none, the cache is empty.
+        bool load();
+
+        /// \effects Writes the manifest to the cache directory,
+        /// creating it if necessary.
+        /// Does nothing if the cache is only kept in memory.
+        void save() const;
+
+        /// \returns The directory the cache is stored in,
+        /// empty if it is only kept in memory.
+        const fs::path& directory() const noexcept
+        {
+            return directory_;
+        }
+
+        /// \effects Removes all information.
+        void clear() noexcept;
+
+        /// \returns The fingerprint of the options that affect the output.
+        std::uint64_t options() const noexcept
+        {
+            return options_;
+        }
+
+        void set_options(std::uint64_t fingerprint) noexcept
+        {
+            options_ = fingerprint;
+        }
+
+        /// \returns The record of the given file, if there is any.
+        const file_record* lookup(const std::string& path) const noexcept;
+
+        const std::map<std::string, file_record>& records() const noexcept
+        {
+            return records_;
+        }
+
+        void add_record(file_record record);
+
+        /// \returns The records of the index documents.
+        const std::vector<document_record>& index_documents() const noexcept
+        {
+            return index_documents_;
+        }
+
+        void set_index_documents(std::vector<document_record> documents)
+        {
+            index_documents_ = std::move(documents);
+        }
+
+        /// \returns The files that were written.
+        const std::vector<std::string>& outputs() const noexcept
+        {
+            return outputs_;
+        }
+
+        void set_outputs(std::vector<std::string> outputs)
+        {
+            outputs_ = std::move(outputs);
+        }
+
+    private:
+        fs::path                           directory_;
+        std::map<std::string, file_record> records_;
+        std::vector<document_record>       index_documents_;
+        std::vector<std::string>           outputs_;
+        std::uint64_t                      options_;
+    };
+
+    /// Computes the keys of input files.
+    ///
+    /// The key of a file is the hash of its content, its compile flags,
+    /// and the content of all files it includes, directly or indirectly.
+    /// The includes of an input file are taken from its record,
+    /// all other files are scanned for `#include` directives.
+    class key_calculator
+    {
+    public:
+        explicit key_calculator(const std::map<std::string, file_record>& records)
+        : records_(&records)
+        {
+        }
+
+        /// \returns The key of the given file parsed with the given flags.
+        std::uint64_t get_key(const std::string& path, const std::vector<std::string>& flags);
+
+        /// \returns The full paths of the files directly included by the given file,
+        /// with the include directories taken from the given flags.
+        std::vector<std::string> get_includes(const std::string&              path,
+                                              const std::vector<std::string>& flags);
+
+        /// \returns The total size in bytes of the given file and all files it includes,
+        /// directly or indirectly.
+        /// \notes System headers are only found through the includes listed in the records.
+        std::uint64_t get_source_size(const std::string&              path,
+                                      const std::vector<std::string>& flags);
+
+    private:
+        // the file and all files it includes
+        std::set<std::string> get_closure(const std::string&              path,
+                                          const std::vector<std::string>& flags);
+
+        std::uint64_t get_content_hash(const std::string& path);
+
+        const std::vector<std::string>& get_direct_includes(
+            const std::string& path, const std::vector<std::string>& include_dirs);
+
+        const std::map<std::string, file_record>*       records_;
+        std::map<std::string, std::uint64_t>            content_hashes_;
+        std::map<std::string, std::uint64_t>            file_sizes_;
+        std::map<std::string, std::vector<std::string>> scanned_includes_;
+    };
+
+    /// \returns The full paths of all files included by the given file.
+    std::vector<std::string> get_includes(const cppast::cpp_file& file);
+} // namespace standardese_tool
+
+#endif // STANDARDESE_TOOL_CACHE_HPP_INCLUDED
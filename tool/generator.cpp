@@ -4,46 +4,122 @@
 
 #include "generator.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <map>
 
 #include <standardese/index.hpp>
 #include <standardese/linker.hpp>
 
-#include "thread_pool.hpp"
+#include "cache.hpp"
+#include "profiler.hpp"
 
 using namespace standardese_tool;
 
+cppast::libclang_compile_config standardese_tool::get_file_config(
+    const cppast::libclang_compile_config&                            config,
+    const type_safe::optional<cppast::libclang_compilation_database>& database,
+    const fs::path&                                                   path)
+{
+    auto db_config = database.map([&](const cppast::libclang_compilation_database& db) {
+        return cppast::find_config_for(db, path.generic_string());
+    });
+    return db_config.value_or(config);
+}
+
+standardese_tool::comment_scan standardese_tool::scan_comments(
+    const std::string& content, const standardese::comment::config& config)
+{
+    auto result = comment_scan::none;
+
+    // memchr() is vectorized, so search for the slash and look at the following characters
+    auto end = content.data() + content.size();
+    for (auto cur = content.data();
+         (cur = static_cast<const char*>(std::memchr(cur, '/', std::size_t(end - cur))))
+         && end - cur >= 3;
+         ++cur)
+        if ((cur[1] == '/' && (cur[2] == '/' || cur[2] == '!'))
+            || (cur[1] == '*' && (cur[2] == '*' || cur[2] == '!')))
+        {
+            // `///`, `//!`, `/**` or `/*!`
+            result = comment_scan::local;
+            break;
+        }
+
+    if (result == comment_scan::local)
+    {
+        auto entity_command = config.command_character()
+                              + std::string(config.command_name(
+                                    standardese::comment::command_type::entity));
+        if (content.find(entity_command) != std::string::npos)
+            result = comment_scan::remote;
+    }
+
+    return result;
+}
+
 type_safe::optional<std::vector<parsed_file>> standardese_tool::parse(
     const cppast::libclang_compile_config&                            config,
     const type_safe::optional<cppast::libclang_compilation_database>& database,
-    const std::vector<input_file>& files, const cppast::cpp_entity_index& index,
-    unsigned no_threads)
+    const std::vector<scheduled_file>& files, const cppast::cpp_entity_index& index,
+    const standardese::file_comment_parser& comments, memory_budget& budget, thread_pool& pool)
 {
+    profile_span stage_span("parsing");
+
     std::vector<parsed_file> result;
     bool                     error(false);
     cppast::libclang_parser  parser(cppast::default_logger());
 
-    {
-        std::mutex  mutex;
-        thread_pool pool(no_threads);
-        for (auto& file : files)
+    std::mutex mutex;
+    auto       parse_file = [&](const input_file& file, std::uint64_t memory) {
+        // libclang releases the translation unit once the AST is built,
+        // so the reservation only needs to cover the parsing itself
+        memory_reservation reservation(budget, memory);
+
+        auto start  = std::chrono::steady_clock::now();
+        auto parsed = [&] {
+            profile_span span("libclang parse", file.relative.generic_string());
+            return parser.parse(index, fs::canonical(file.path).generic_string(),
+                                get_file_config(config, database, file.path));
+        }();
+        auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        if (parsed)
         {
-            add_job(pool, [&, file] {
-                auto db_config = database.map([&](const cppast::libclang_compilation_database& db) {
-                    return cppast::find_config_for(db, file.path.generic_string());
-                });
-
-                auto parsed = parser.parse(index, fs::canonical(file.path).generic_string(),
-                                           db_config.value_or(config));
-
-                std::lock_guard<std::mutex> lock(mutex);
-                if (parsed)
-                    result.push_back({std::move(parsed), file.relative.generic_string()});
-                else
-                    error = true;
-            });
+            // no need to wait for the other files
+            profile_span span("comment parse", file.relative.generic_string());
+            comments.parse(type_safe::ref(*parsed));
         }
-    }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (parsed)
+            result.push_back({std::move(parsed), file.relative.generic_string(),
+                              static_cast<std::uint64_t>(time.count()), false});
+        else
+            error = true;
+    };
+
+    std::vector<std::future<void>> futures;
+    for (auto& file : files)
+        if (file.skip)
+        {
+            // it would not contain any documentation, so only the file itself is needed
+            auto empty =
+                cppast::cpp_file::builder(fs::canonical(file.input.path).generic_string())
+                    .finish(index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            result.push_back({std::move(empty), file.input.relative.generic_string(), 0u, true});
+        }
+        else
+            futures.push_back(
+                add_job(pool, [&] { parse_file(file.input, file.memory); }, file.cost));
+    wait_for(pool, futures);
 
     if (error)
         return type_safe::nullopt;
@@ -51,45 +127,128 @@ type_safe::optional<std::vector<parsed_file>> standardese_tool::parse(
         return std::move(result);
 }
 
-standardese::comment_registry standardese_tool::parse_comments(
-    const standardese::comment::config& config, const std::vector<parsed_file>& files,
-    unsigned no_threads)
+std::vector<std::unique_ptr<standardese::doc_cpp_file>> standardese_tool::build_files(
+    const standardese::comment_registry& registry, const cppast::cpp_entity_index& index,
+    std::vector<parsed_file>&& files, const standardese::entity_blacklist& blacklist,
+    thread_pool& pool)
+{
+    profile_span stage_span("building");
+
+    std::vector<std::unique_ptr<standardese::doc_cpp_file>> result;
+
+    // each file is excluded while building it, the entities of other files are only read,
+    // so there is no need to wait for the exclusion of all files
+    std::mutex mutex;
+    auto       build_file = [&](parsed_file& file) {
+        profile_span span("doc-entity build", file.output_name);
+        auto entity = standardese::build_doc_entities(type_safe::ref(registry), index, blacklist,
+                                                      std::move(file.file),
+                                                      std::move(file.output_name));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        result.push_back(std::move(entity));
+    };
+
+    // the parse time is a good estimate for the size of the file
+    std::vector<std::future<void>> futures;
+    for (auto& file : files)
+        futures.push_back(add_job(pool, [&] { build_file(file); }, file.parse_time));
+    wait_for(pool, futures);
+
+    // the inherited members of a base class get the doc entities of the derived class,
+    // register them in a fixed order so that the same one wins in every run
+    std::vector<const standardese::doc_cpp_file*> sorted;
+    for (auto& file : result)
+        sorted.push_back(file.get());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const standardese::doc_cpp_file* a, const standardese::doc_cpp_file* b) {
+                  return a->file().name() < b->file().name();
+              });
+    for (auto file : sorted)
+        standardese::register_injected_entities(*file);
+
+    return result;
+}
+
+std::string standardese_tool::get_document_name(const standardese::doc_cpp_file& file)
 {
-    standardese::file_comment_parser parser(cppast::default_logger(), config);
+    return "doc_" + get_output_file_name(file.output_name());
+}
+
+namespace
+{
+    // files with more entities are split into one job per child of the file and its namespaces,
+    // the members of a class are still generated by the job of the class
+    constexpr auto parallel_generation_threshold = 1024u;
+
+    std::size_t count_entities(const standardese::doc_entity& entity)
     {
-        thread_pool pool(no_threads);
-        for (auto& file : files)
-            add_job(pool, [&file, &parser] { parser.parse(type_safe::ref(*file.file)); });
+        std::size_t result = 1u;
+        for (auto& child : entity)
+            result += count_entities(child);
+        return result;
     }
-    return parser.finish();
-}
+} // namespace
 
-std::vector<std::unique_ptr<standardese::doc_cpp_file>> standardese_tool::build_files(
-    const standardese::comment_registry& registry, const cppast::cpp_entity_index& index,
-    std::vector<parsed_file>&& files, const standardese::entity_blacklist& blacklist,
-    unsigned no_threads)
+documents standardese_tool::generate_document(const standardese::generation_config& gen_config,
+                                              const standardese::synopsis_config&   syn_config,
+                                              const cppast::cpp_entity_index&       index,
+                                              const standardese::doc_cpp_file&      file,
+                                              bool split_pages, thread_pool& pool)
 {
+    auto name = get_document_name(file);
+
+    auto config = gen_config;
+    if (count_entities(file) > parallel_generation_threshold)
+        // otherwise a single big file is generated while the other threads are idle
+        config.set_executor([&](const std::vector<std::function<void()>>& tasks) {
+            // the file is already being generated, so its parts go before all pending files
+            std::vector<std::future<void>> futures;
+            for (auto& task : tasks)
+                futures.push_back(add_job(pool, task, std::numeric_limits<std::uint64_t>::max()));
+            wait_for(pool, futures);
+        });
+
+    documents                                    result;
+    std::vector<standardese::documentation_page> pages;
+
+    standardese::markup::subdocument::builder document(file.output_name(), name);
     {
-        thread_pool pool(no_threads);
-        for (auto& file : files)
-            add_job(pool,
-                    [&] { standardese::exclude_entities(registry, index, blacklist, *file.file); });
+        // includes the synopsis, it is generated as part of the documentation
+        profile_span span("documentation generation", name);
+        if (split_pages)
+            document.add_child(
+                standardese::generate_documentation(config, syn_config, index, file, pages));
+        else
+            document.add_child(
+                standardese::generate_documentation(config, syn_config, index, file));
     }
+    result.push_back(document.finish());
 
-    std::vector<std::unique_ptr<standardese::doc_cpp_file>> result;
+    // the output form of an id replaces special characters,
+    // so different link names like `foo<int*>` and `foo<int&>` can have the same one
+    std::map<std::string, unsigned> no_ids;
+    for (auto& page : pages)
+        ++no_ids[standardese::markup::block_id(page.name).as_output_str()];
 
+    for (auto& page : pages)
     {
-        std::mutex  mutex;
-        thread_pool pool(no_threads);
-        for (auto& file : files)
-            add_job(pool, [&] {
-                auto entity = standardese::build_doc_entities(type_safe::ref(registry), index,
-                                                              std::move(file.file),
-                                                              std::move(file.output_name));
-
-                std::lock_guard<std::mutex> lock(mutex);
-                result.push_back(std::move(entity));
-            });
+        auto id        = standardese::markup::block_id(page.name).as_output_str();
+        auto page_name = name + '-' + id;
+        if (no_ids[id] > 1u)
+        {
+            // the link names are unique in the file, so add their hash
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx",
+                          static_cast<unsigned long long>(hasher().add(page.name).value()));
+            page_name += '-';
+            page_name += hash;
+        }
+
+        standardese::markup::subdocument::builder page_document(page.title, page_name);
+        for (auto& documentation : page.documentations)
+            page_document.add_child(std::move(documentation));
+        result.push_back(page_document.finish());
     }
 
     return result;
@@ -107,75 +266,128 @@ namespace
     }
 }
 
-documents standardese_tool::generate(
+void standardese_tool::generate(
     const standardese::generation_config& gen_config,
     const standardese::synopsis_config& syn_config, const standardese::comment_registry& comments,
     const cppast::cpp_entity_index& index, const standardese::linker& linker,
-    const std::vector<std::unique_ptr<standardese::doc_cpp_file>>& files, unsigned no_threads)
+    const std::vector<std::unique_ptr<standardese::doc_cpp_file>>& files, bool split_pages,
+    const document_sink& sink, thread_pool& pool)
 {
-    std::mutex                                                         result_mutex;
-    std::vector<std::unique_ptr<standardese::markup::document_entity>> result;
+    profile_span stage_span("generating");
+
+    std::vector<std::future<void>> futures;
+    for (auto& file : files)
+        futures.push_back(add_job(pool, [&] {
+            auto name = get_document_name(*file);
+            auto finished_docs =
+                generate_document(gen_config, syn_config, index, *file, split_pages, pool);
+            {
+                profile_span span("linker registration", name);
+                // the pages need to be registered together with the file
+                std::vector<const standardese::markup::document_entity*> registered;
+                for (auto& doc : finished_docs)
+                    registered.push_back(doc.get());
+                standardese::register_documentations(*cppast::default_logger(), linker, registered);
+            }
+
+            standardese::index_entries entries;
+            {
+                profile_span span("index entries", name);
+                entries = standardese::get_index_entries(comments, *file);
+            }
+
+            sink(*file, std::move(finished_docs), std::move(entries));
+        }));
+
+    wait_for(pool, futures);
+}
+
+documents standardese_tool::generate_index_documents(
+    const standardese::generation_config& gen_config, const standardese::linker& linker,
+    const std::vector<const standardese::index_entries*>& entries, thread_pool& pool)
+{
+    profile_span stage_span("generating indices");
 
     standardese::entity_index eindex;
     standardese::file_index   findex;
     standardese::module_index mindex;
 
     {
-        thread_pool pool(no_threads);
-
-        std::vector<std::future<void>> futures;
-        for (auto& file : files)
-            futures.push_back(add_job(pool, [&] {
-                standardese::markup::subdocument::builder document(file->output_name(),
-                                                                   "doc_"
-                                                                       + get_output_file_name(
-                                                                             file->output_name()));
-                document.add_child(
-                    standardese::generate_documentation(gen_config, syn_config, index, *file));
-                auto finished_doc = document.finish();
-
-                standardese::register_documentations(*cppast::default_logger(), linker,
-                                                     *finished_doc);
-                standardese::register_index_entities(eindex, file->file());
-                standardese::register_module_entities(mindex, comments, file->file());
-                findex.register_file(file->link_name(), file->output_name(),
-                                     file->comment() ? file->comment().value().brief_section() :
-                                                       nullptr);
-
-                std::lock_guard<std::mutex> lock(result_mutex);
-                result.push_back(std::move(finished_doc));
-            }));
-
-        for (auto& future : futures)
-            future.get(); // to retrieve exceptions
+        profile_span span("index registration");
+        for (auto file_entries : entries)
+            standardese::register_index_entries(eindex, findex, mindex, *file_entries);
     }
 
-    auto eindex_doc =
-        get_index_document(eindex.generate(gen_config.order()), "Entities", "standardese_entities");
-    standardese::register_documentations(*cppast::default_logger(), linker, *eindex_doc);
-    result.push_back(std::move(eindex_doc));
-
-    auto findex_doc = get_index_document(findex.generate(), "Files", "standardese_files");
-    standardese::register_documentations(*cppast::default_logger(), linker, *findex_doc);
-    result.push_back(std::move(findex_doc));
+    // the indices are independent of each other
+    using index_doc = std::unique_ptr<standardese::markup::document_entity>;
+    auto add_index  = [&](std::function<index_doc()> generate_index) {
+        return add_job(pool, [&, generate_index] {
+            profile_span span("index generation");
 
-    auto mindex_doc = get_index_document(mindex.generate(), "Modules", "standardese_modules");
-    standardese::register_documentations(*cppast::default_logger(), linker, *mindex_doc);
-    result.push_back(std::move(mindex_doc));
+            auto doc = generate_index();
+            standardese::register_documentations(*cppast::default_logger(), linker, *doc);
+            return doc;
+        });
+    };
 
-    for (auto& doc : result)
-        standardese::resolve_links(*cppast::default_logger(), linker, *doc);
+    std::vector<std::future<index_doc>> futures;
+    futures.push_back(add_index([&] {
+        return get_index_document(eindex.generate(gen_config.order()), "Entities",
+                                  "standardese_entities");
+    }));
+    futures.push_back(add_index([&] {
+        return get_index_document(findex.generate(), "Files", "standardese_files");
+    }));
+    futures.push_back(add_index([&] {
+        return get_index_document(mindex.generate(), "Modules", "standardese_modules");
+    }));
+    for (auto& future : futures)
+        pool.wait(future);
 
+    // order is entities, files, modules
+    documents result;
+    for (auto& future : futures)
+        result.push_back(future.get());
     return result;
 }
 
-void standardese_tool::write_files(const documents& docs, standardese::markup::generator generator,
-                                   std::string prefix, const char* extension, unsigned no_threads)
+void standardese_tool::resolve_links(const standardese::linker& linker, const documents& docs,
+                                     thread_pool& pool)
 {
-    thread_pool pool(no_threads);
+    profile_span stage_span("resolving links");
+
+    // the linker isn't modified anymore, so documents can be resolved concurrently
+    std::vector<std::future<void>> futures;
     for (auto& doc : docs)
-        add_job(pool, [&] {
-            std::ofstream file(prefix + doc->output_name().file_name(extension));
-            generator(file, *doc);
-        });
+        futures.push_back(add_job(pool, [&] {
+            profile_span span("link resolution", doc->output_name().name());
+            standardese::resolve_links(*cppast::default_logger(), linker, *doc);
+        }));
+    wait_for(pool, futures);
+}
+
+void standardese_tool::write_document(const standardese::markup::document_entity& doc,
+                                      const std::vector<output_format>&           formats)
+{
+    for (auto& format : formats)
+    {
+        auto         name = doc.output_name().file_name(format.extension);
+        profile_span span("write", name);
+
+        std::ofstream file(format.prefix + name);
+        format.generator(file, doc);
+    }
+}
+
+void standardese_tool::write_files(const documents& docs, const std::vector<output_format>& formats,
+                                   thread_pool& pool)
+{
+    profile_span stage_span("writing");
+
+    // the document is only shared between the formats of a single job,
+    // so it is still in the cache when the next format is written
+    std::vector<std::future<void>> futures;
+    for (auto& doc : docs)
+        futures.push_back(add_job(pool, [&] { write_document(*doc, formats); }));
+    wait_for(pool, futures);
 }
@@ -5,6 +5,8 @@
 #ifndef STANDARDESE_TOOL_GENERATOR_HPP_INCLUDED
 #define STANDARDESE_TOOL_GENERATOR_HPP_INCLUDED
 
+#include <cstdint>
+#include <functional>
 #include <vector>
 
 #include <cppast/cpp_entity_index.hpp>
@@ -15,9 +17,11 @@
 #include <standardese/markup/generator.hpp>
 #include <standardese/comment.hpp>
 #include <standardese/doc_entity.hpp>
+#include <standardese/index.hpp>
 #include <standardese/linker.hpp>
 
 #include "filesystem.hpp"
+#include "thread_pool.hpp"
 
 namespace standardese_tool
 {
@@ -27,38 +31,124 @@ namespace standardese_tool
         fs::path relative;
     };
 
+    /// An input file that is going to be parsed.
+    struct scheduled_file
+    {
+        input_file    input;
+        std::uint64_t cost;   //< estimated cost of parsing it, higher ones are parsed first
+        std::uint64_t memory; //< estimated memory needed to parse it, in bytes
+        bool          skip;   //< whether it has no documentation comments and isn't parsed at all
+    };
+
     struct parsed_file
     {
         std::unique_ptr<cppast::cpp_file> file;
         std::string                       output_name;
+        std::uint64_t                     parse_time; //< in microseconds
+        bool                              skipped;    //< whether it is empty as it wasn't parsed
     };
 
-    type_safe::optional<std::vector<parsed_file>> parse(
+    /// Which documentation comments [standardese_tool::scan_comments]() found.
+    enum class comment_scan
+    {
+        none,   //< no documentation comments
+        local,  //< documentation comments
+        remote, //< documentation comments that might document entities of other files
+    };
+
+    /// \returns Which documentation comments the file content might contain.
+    /// \notes This only looks for the characters starting a documentation comment
+    /// or an entity command, so it has false positives but no false negatives.
+    comment_scan scan_comments(const std::string&                  content,
+                               const standardese::comment::config& config);
+
+    /// \returns The compile config for the given file,
+    /// taken from the compilation database if there is one.
+    cppast::libclang_compile_config get_file_config(
         const cppast::libclang_compile_config&                            config,
         const type_safe::optional<cppast::libclang_compilation_database>& database,
-        const std::vector<input_file>& files, const cppast::cpp_entity_index& index,
-        unsigned no_threads);
+        const fs::path&                                                   path);
 
-    standardese::comment_registry parse_comments(const standardese::comment::config& config,
-                                                 const std::vector<parsed_file>&     files,
-                                                 unsigned                            no_threads);
+    /// \effects Parses the files and passes them to the comment parser,
+    /// the comments of a file are parsed as soon as the file itself is parsed.
+    /// Each file reserves its memory from the budget while it is parsed.
+    /// Files that are skipped are not parsed, but an empty file is created for them.
+    /// \notes The comment parser must be finished afterwards.
+    type_safe::optional<std::vector<parsed_file>> parse(
+        const cppast::libclang_compile_config&                            config,
+        const type_safe::optional<cppast::libclang_compilation_database>& database,
+        const std::vector<scheduled_file>& files, const cppast::cpp_entity_index& index,
+        const standardese::file_comment_parser& comments, memory_budget& budget,
+        thread_pool& pool);
 
     std::vector<std::unique_ptr<standardese::doc_cpp_file>> build_files(
         const standardese::comment_registry& registry, const cppast::cpp_entity_index& index,
         std::vector<parsed_file>&& files, const standardese::entity_blacklist& blacklist,
-        unsigned no_threads);
+        thread_pool& pool);
 
     using documents = std::vector<std::unique_ptr<standardese::markup::document_entity>>;
 
-    documents generate(const standardese::generation_config& gen_config,
-                       const standardese::synopsis_config&   syn_config,
-                       const standardese::comment_registry&  comments,
-                       const cppast::cpp_entity_index& index, const standardese::linker& linker,
-                       const std::vector<std::unique_ptr<standardese::doc_cpp_file>>& files,
-                       unsigned                                                       no_threads);
+    /// \returns The output name of the document generated for the file.
+    std::string get_document_name(const standardese::doc_cpp_file& file);
+
+    /// \returns The documents of the file,
+    /// the one named by [standardese_tool::get_document_name]() comes first.
+    /// If `split_pages` is `true`, it is followed by one document for each page of the file.
+    /// The documentation of big files is generated by multiple jobs in the pool.
+    /// \notes They are not registered in the linker and the links are not resolved yet.
+    documents generate_document(const standardese::generation_config& gen_config,
+                                const standardese::synopsis_config&   syn_config,
+                                const cppast::cpp_entity_index& index,
+                                const standardese::doc_cpp_file& file, bool split_pages,
+                                thread_pool& pool);
+
+    /// Receives the generated documents of a file and its index entries,
+    /// it is called concurrently.
+    using document_sink = std::function<void(const standardese::doc_cpp_file&, documents,
+                                             standardese::index_entries)>;
+
+    /// \effects Generates the documents and index entries of the files,
+    /// and registers the documents in the linker,
+    /// they are passed to the sink by the job that generated them, after they are registered.
+    /// If `split_pages` is `true`, classes, namespaces and output sections get their own document.
+    /// \notes The links are not resolved yet.
+    /// A file isn't used anymore once its documents are passed to the sink,
+    /// so the sink may destroy the files whose documents it already received.
+    void generate(const standardese::generation_config& gen_config,
+                  const standardese::synopsis_config&   syn_config,
+                  const standardese::comment_registry&  comments,
+                  const cppast::cpp_entity_index& index, const standardese::linker& linker,
+                  const std::vector<std::unique_ptr<standardese::doc_cpp_file>>& files,
+                  bool split_pages, const document_sink& sink, thread_pool& pool);
+
+    /// \effects Generates the index documents given the index entries of all files,
+    /// and registers them in the linker.
+    /// \returns The index documents in the order entities, files, modules.
+    /// \notes The links are not resolved yet.
+    documents generate_index_documents(
+        const standardese::generation_config& gen_config, const standardese::linker& linker,
+        const std::vector<const standardese::index_entries*>& entries, thread_pool& pool);
+
+    /// \effects Resolves the links of all documents.
+    /// \requires All documents must have been registered in the linker.
+    void resolve_links(const standardese::linker& linker, const documents& docs, thread_pool& pool);
+
+    /// An output format the documents are written in.
+    struct output_format
+    {
+        standardese::markup::generator generator;
+        std::string                    prefix; //< prefix of the output file names
+        const char*                    extension;
+    };
+
+    /// \effects Writes the document in all formats.
+    void write_document(const standardese::markup::document_entity& doc,
+                        const std::vector<output_format>&           formats);
 
-    void write_files(const documents& docs, standardese::markup::generator generator,
-                     std::string prefix, const char* extension, unsigned no_threads);
+    /// \effects Writes each document in all formats,
+    /// with one job per document.
+    void write_files(const documents& docs, const std::vector<output_format>& formats,
+                     thread_pool& pool);
 } // namespace standardese_tool
 
 #endif // STANDARDESE_TOOL_GENERATOR_HPP_INCLUDED
@@ -2,14 +2,19 @@
 // This file is subject to the license terms in the LICENSE file
 // found in the top-level directory of this distribution.
 
+#include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include <boost/program_options.hpp>
 
+#include "cache.hpp"
 #include "filesystem.hpp"
-#include "generator.hpp"
+#include "pipeline.hpp"
+#include "profiler.hpp"
 #include "thread_pool.hpp"
+#include "watcher.hpp"
 
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -285,9 +290,63 @@ standardese::entity_blacklist get_blacklist(const po::variables_map& options)
     return blacklist;
 }
 
-void register_external_documentations(standardese::linker& l, const po::variables_map& options)
+type_safe::optional<standardese_tool::shard> get_shard(const po::variables_map& options)
 {
-    l.register_external("std", "http://en.cppreference.com/mwiki/"
+    auto str = get_option<std::string>(options, "shard");
+    if (!str)
+        return type_safe::nullopt;
+
+    standardese_tool::shard result;
+    char                    slash;
+    std::istringstream      in(str.value());
+    if (!(in >> result.index >> slash >> result.count) || slash != '/' || in.peek() != EOF
+        || result.index >= result.count)
+        throw std::invalid_argument("invalid shard '" + str.value() + "'");
+    return result;
+}
+
+std::uint64_t get_max_memory(const po::variables_map& options)
+{
+    auto str = get_option<std::string>(options, "max-memory");
+    if (!str)
+        return 0u;
+
+    std::uint64_t      result;
+    char               suffix = 0;
+    std::istringstream in(str.value());
+    if (!(in >> result) || (in >> suffix && in.peek() != EOF))
+        throw std::invalid_argument("invalid memory size '" + str.value() + "'");
+
+    switch (suffix)
+    {
+    case 0:
+        return result;
+    case 'K':
+    case 'k':
+        return result << 10;
+    case 'M':
+    case 'm':
+        return result << 20;
+    case 'G':
+    case 'g':
+        return result << 30;
+    default:
+        throw std::invalid_argument("invalid memory size '" + str.value() + "'");
+    }
+}
+
+bool get_skip_uncommented(const po::variables_map& options)
+{
+    // uncommented files are documented otherwise
+    return get_option<bool>(options, "input.require_comment").value()
+           && get_option<bool>(options, "input.skip_uncommented").value();
+}
+
+std::vector<std::pair<std::string, std::string>> get_external_documentations(
+    const po::variables_map& options)
+{
+    std::vector<std::pair<std::string, std::string>> result;
+    result.emplace_back("std", "http://en.cppreference.com/mwiki/"
                                "index.php?title=Special%3ASearch&search=$$");
 
     auto external = get_option<std::vector<std::string>>(options, "comment.external_doc").value();
@@ -299,8 +358,56 @@ void register_external_documentations(standardese::linker& l, const po::variable
 
         auto ns_name = arg.substr(0, equal);
         auto url     = arg.substr(equal + 1u);
-        l.register_external(std::move(ns_name), std::move(url));
+        result.emplace_back(std::move(ns_name), std::move(url));
+    }
+
+    return result;
+}
+
+// hash of all options that affect the generated documentation
+std::uint64_t get_options_fingerprint(const po::variables_map& options)
+{
+    standardese_tool::hasher h;
+    h.add(std::uint64_t(STANDARDESE_VERSION_MAJOR)).add(std::uint64_t(STANDARDESE_VERSION_MINOR));
+
+    for (auto& option : options)
+    {
+        if (option.first == "config" || option.first == "verbose" || option.first == "jobs"
+            || option.first == "max-memory" || option.first == "cache-dir"
+            || option.first == "incremental" || option.first == "watch"
+            || option.first == "profile" || option.first == "stream" || option.first == "shard"
+            || option.first == "merge" || option.second.empty())
+            continue;
+        h.add(option.first);
+
+        auto& value = option.second.value();
+        if (auto str = boost::any_cast<std::string>(&value))
+            h.add(*str);
+        else if (auto strs = boost::any_cast<std::vector<std::string>>(&value))
+        {
+            h.add(std::uint64_t(strs->size()));
+            for (auto& str : *strs)
+                h.add(str);
+        }
+        else if (auto paths = boost::any_cast<std::vector<fs::path>>(&value))
+        {
+            h.add(std::uint64_t(paths->size()));
+            for (auto& path : *paths)
+                h.add(path.generic_string());
+        }
+        else if (auto b = boost::any_cast<bool>(&value))
+            h.add(std::uint64_t(*b));
+        else if (auto u = boost::any_cast<unsigned>(&value))
+            h.add(std::uint64_t(*u));
+        else if (auto c = boost::any_cast<char>(&value))
+            h.add(std::uint64_t(static_cast<unsigned char>(*c)));
+        else
+            // leaving it out of the hash would reuse documentation generated with another value
+            throw std::logic_error("option '" + option.first
+                                   + "' has a type that isn't handled by the cache");
     }
+
+    return h.value();
 }
 
 int main(int argc, char* argv[])
@@ -314,7 +421,27 @@ int main(int argc, char* argv[])
         ("verbose,v", po::value<bool>()->implicit_value(true)->default_value(false),
          "prints more information")
         ("jobs,j", po::value<unsigned>()->default_value(standardese_tool::default_no_threads()),
-         "sets the number of threads to use");
+         "sets the number of threads to use")
+        ("max-memory", po::value<std::string>(),
+         "limits the estimated memory used by files parsed at the same time and the cached comments, in bytes with an optional K, M or G suffix")
+        ("cache-dir", po::value<std::string>(),
+         "directory where information about the previous run is stored, "
+         "if no input file or option changed, the documentation isn't generated again")
+        ("incremental", po::value<bool>()->implicit_value(true)->default_value(false),
+         "only regenerate the documents affected by changes since the previous run, requires cache-dir")
+        ("watch", po::value<bool>()->implicit_value(true)->default_value(false),
+         "keep running and incrementally regenerate the documentation whenever an input file changes (Linux only)")
+        ("stream", po::value<bool>()->implicit_value(true)->default_value(false),
+         "write the documents of each file as soon as their links can be resolved and free the file afterwards, "
+         "instead of keeping all of them in memory")
+        ("shard", po::value<std::string>(),
+         "only generate the documentation of one part of the input files, given as 'index/count' with a zero-based index, "
+         "the results are stored in cache-dir and combined by merge")
+        ("merge", po::value<unsigned>(),
+         "combine the results of the given number of shards stored in cache-dir, "
+         "regenerate the documents affected by other shards and write the index documents")
+        ("profile", po::value<std::string>(),
+         "write the time spent in each stage and file as Chrome trace event JSON to the given file");
 
     configuration.add_options()
         ("input.source_ext",
@@ -342,6 +469,10 @@ int main(int argc, char* argv[])
         ("input.require_comment",
          po::value<bool>()->implicit_value(true)->default_value(true),
          "only generates documentation for entities that have a documentation comment")
+        ("input.skip_uncommented",
+         po::value<bool>()->implicit_value(true)->default_value(false),
+         "don't parse files without any documentation comment if require_comment is set, "
+         "they are still listed in the file index but their documentation has no synopsis")
         ("input.extract_private",
          po::value<bool>()->implicit_value(true)->default_value(false),
          "whether or not to document private entities")
@@ -408,7 +539,9 @@ int main(int argc, char* argv[])
         ("output.show_macro_replacement", po::value<bool>()->default_value(false)->implicit_value(true),
          "whether or not the replacement of macros will be shown")
         ("output.show_group_output_section", po::value<bool>()->default_value(true)->implicit_value(true),
-         "whether or not member groups have an implicit output section");
+         "whether or not member groups have an implicit output section")
+        ("output.split_pages", po::value<bool>()->default_value(false)->implicit_value(true),
+         "whether or not classes, namespaces and output sections are written to their own page, the page of the file only links to them");
     // clang-format on
 
     try
@@ -421,61 +554,138 @@ int main(int argc, char* argv[])
             print_usage(argv[0], generic, configuration);
         else
         {
-            auto no_threads = get_option<unsigned>(options, "jobs").value();
+            auto profile = get_option<std::string>(options, "profile");
+            if (profile)
+                standardese_tool::get_profiler().enable();
+            auto write_profile = [&] {
+                if (profile)
+                {
+                    std::ofstream out(profile.value());
+                    standardese_tool::get_profiler().write(out);
+                }
+            };
+
+            standardese_tool::pipeline_config config{get_compile_config(options),
+                                                     get_compilation_database(options),
+                                                     get_comment_config(options),
+                                                     get_synopsis_config(options),
+                                                     get_generation_config(options),
+                                                     get_blacklist(options),
+                                                     get_skip_uncommented(options),
+                                                     get_option<bool>(options,
+                                                                      "output.split_pages")
+                                                         .value(),
+                                                     get_external_documentations(options),
+                                                     get_formats(options),
+                                                     get_option<std::string>(options,
+                                                                             "output.prefix")
+                                                         .value(),
+                                                     get_options_fingerprint(options),
+                                                     get_option<unsigned>(options, "jobs")
+                                                         .value(),
+                                                     get_max_memory(options),
+                                                     get_option<bool>(options, "stream").value()};
+            auto input = get_input(options);
+
+            type_safe::optional<standardese_tool::cache> cache;
+            if (auto dir = get_option<std::string>(options, "cache-dir"))
+            {
+                cache.emplace(dir.value());
+                cache.value().load();
+            }
 
-            auto compile_config = get_compile_config(options);
-            auto database       = get_compilation_database(options);
-            auto input          = get_input(options);
+            auto watch       = get_option<bool>(options, "watch").value();
+            auto incremental = get_option<bool>(options, "incremental").value();
+            if (watch)
+            {
+                if (!cache)
+                    // only keep it in memory
+                    cache.emplace();
+                incremental = true;
+            }
+            else if (incremental && !cache)
+                throw std::invalid_argument("incremental requires a cache directory");
 
-            auto comment_config    = get_comment_config(options);
-            auto synopsis_config   = get_synopsis_config(options);
-            auto generation_config = get_generation_config(options);
+            auto shard = get_shard(options);
+            auto merge = get_option<unsigned>(options, "merge");
+            if (shard || merge)
+            {
+                auto dir = get_option<std::string>(options, "cache-dir");
+                if (!dir)
+                    throw std::invalid_argument("shard and merge require a cache directory");
+                else if (shard && merge)
+                    throw std::invalid_argument("shard and merge can't be used at the same time");
+                else if (watch || incremental)
+                    throw std::invalid_argument(
+                        "shard and merge can't be combined with watch or incremental");
+
+                auto result = false;
+                if (shard)
+                {
+                    // the cache of the previous merge is only read
+                    standardese_tool::cache partial(
+                        standardese_tool::get_shard_directory(dir.value(), shard.value()));
+                    result = standardese_tool::run_shard(config, input, cache.value(), partial,
+                                                         shard.value());
+                }
+                else
+                {
+                    std::vector<standardese_tool::cache> shards;
+                    for (auto i = 0u; i != merge.value(); ++i)
+                    {
+                        shards.emplace_back(
+                            standardese_tool::get_shard_directory(dir.value(),
+                                                                  {i, merge.value()}));
+                        if (!shards.back().load())
+                            throw std::runtime_error("no results of shard " + std::to_string(i)
+                                                     + '/' + std::to_string(merge.value())
+                                                     + " in the cache directory");
+                    }
+                    result = standardese_tool::merge_shards(config, input, cache.value(), shards);
+                }
 
-            auto blacklist = get_blacklist(options);
+                write_profile();
+                return result ? 0 : 1;
+            }
 
-            auto formats = get_formats(options);
-            auto prefix  = get_option<std::string>(options, "output.prefix").value();
+            auto input_paths = get_option<std::vector<fs::path>>(options, "input-files").value();
+            for (auto first = true; first || watch; first = false)
+            {
+                // start watching before generation, so no change is missed
+                type_safe::optional<standardese_tool::file_watcher> watcher;
+                if (watch)
+                    watcher.emplace(standardese_tool::get_watched_directories(input_paths, input,
+                                                                              cache.value()),
+                                    cache.value());
+
+                try
+                {
+                    if (!first)
+                        input = get_input(options);
+
+                    if (!standardese_tool::run_pipeline(config, input,
+                                                        type_safe::opt_ref(
+                                                            cache ? &cache.value() : nullptr),
+                                                        incremental)
+                        && !watch)
+                        return 1;
+                }
+                catch (std::exception& ex)
+                {
+                    if (!watch)
+                        throw;
+                    std::cerr << "error: " << ex.what() << '\n';
+                }
 
-            standardese::linker linker;
-            register_external_documentations(linker, options);
+                // write it after every run, in watch mode there might not be a last one
+                write_profile();
 
-            try
-            {
-                cppast::cpp_entity_index index;
-
-                std::clog << "parsing C++ files...\n";
-                auto parsed =
-                    standardese_tool::parse(compile_config, database, input, index, no_threads);
-                if (!parsed)
-                    return 1;
-
-                std::clog << "parsing documentation comments...\n";
-                auto comments =
-                    standardese_tool::parse_comments(comment_config, parsed.value(), no_threads);
-                auto files =
-                    standardese_tool::build_files(comments, index, std::move(parsed.value()),
-                                                  blacklist, no_threads);
-
-                std::clog << "generating documentation...\n";
-                auto docs = standardese_tool::generate(generation_config, synopsis_config, comments,
-                                                       index, linker, files, no_threads);
-
-                for (auto& format : formats)
+                if (watcher)
                 {
-                    std::clog << "writing files in format '" << format.second << "'...\n";
-
-                    auto format_prefix =
-                        formats.size() > 1u ? std::string(format.second) + '/' + prefix : prefix;
-                    if (!format_prefix.empty())
-                        fs::create_directories(fs::path(format_prefix).parent_path());
-                    standardese_tool::write_files(docs, format.first, std::move(format_prefix),
-                                                  format.second, no_threads);
+                    std::clog << "watching for changes...\n";
+                    watcher.value().wait();
                 }
             }
-            catch (std::exception& ex)
-            {
-                std::cerr << "error: " << ex.what() << '\n';
-            }
         }
     }
     catch (std::exception& ex)
@@ -0,0 +1,1306 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+
+#include <standardese/markup/entity_kind.hpp>
+#include <standardese/markup/generator.hpp>
+#include <standardese/markup/index.hpp>
+#include <standardese/markup/link.hpp>
+#include <standardese/markup/visitor.hpp>
+#include <standardese/index.hpp>
+
+#include "profiler.hpp"
+
+using namespace standardese_tool;
+
+namespace
+{
+    // canonical path to input file
+    using input_map = std::map<std::string, const input_file*>;
+
+    input_map get_input_map(const std::vector<input_file>& input)
+    {
+        input_map result;
+        for (auto& file : input)
+            result.emplace(fs::canonical(file.path).generic_string(), &file);
+        return result;
+    }
+
+    std::set<std::string> get_all_files(const input_map& inputs)
+    {
+        std::set<std::string> result;
+        for (auto& pair : inputs)
+            result.insert(pair.first);
+        return result;
+    }
+
+    std::vector<std::string> get_flags(const pipeline_config& config, const std::string& path)
+    {
+        return get_file_config(config.compile_config, config.database, path).get_flags();
+    }
+
+    std::uint64_t get_key(key_calculator& calculator, const pipeline_config& config,
+                          const std::string& path)
+    {
+        return calculator.get_key(path, get_flags(config, path));
+    }
+
+    // returns the files whose key changed since the last run,
+    // or all files if the previous run can't be used
+    std::set<std::string> get_dirty_files(const pipeline_config& config, const input_map& inputs,
+                                          const cache& c)
+    {
+        profile_span span("checking cache");
+
+        if (c.options() != config.options || c.records().size() != inputs.size())
+            return get_all_files(inputs);
+        for (auto& output : c.outputs())
+            if (!fs::exists(output))
+                return get_all_files(inputs);
+
+        std::set<std::string> result;
+        key_calculator        calculator(c.records());
+        for (auto& pair : inputs)
+        {
+            auto record = c.lookup(pair.first);
+            if (!record)
+                // set of input files changed
+                return get_all_files(inputs);
+            else if (record->key != get_key(calculator, config, pair.first))
+                result.insert(pair.first);
+        }
+        return result;
+    }
+
+    // returns the files that need to be parsed in order to regenerate the dirty ones:
+    // the dirty files, all input files they include and all files with remote comments
+    std::set<std::string> get_parse_set(const std::set<std::string>& dirty, const input_map& inputs,
+                                        const cache& c)
+    {
+        std::vector<std::string> stack(dirty.begin(), dirty.end());
+        for (auto& pair : c.records())
+            if (pair.second.has_remote_comments)
+                stack.push_back(pair.first);
+
+        std::set<std::string> result;
+        while (!stack.empty())
+        {
+            auto cur = std::move(stack.back());
+            stack.pop_back();
+            if (!inputs.count(cur) || !result.insert(cur).second)
+                continue;
+
+            for (auto& include : c.lookup(cur)->includes)
+                stack.push_back(include);
+        }
+        return result;
+    }
+
+    // the documentation of a set of files
+    struct generation
+    {
+        cppast::cpp_entity_index                                index;
+        standardese::linker                                     linker;
+        standardese::comment_registry                           comments; //< used by the files
+        std::vector<std::unique_ptr<standardese::doc_cpp_file>> files; //< null once streamed
+        standardese::synopsis_reference_table                   references; //< when streaming
+        documents                                               docs;
+        std::map<std::string, std::string>                      doc_files; //< file of each document
+        std::vector<file_record>                                records;
+        std::vector<document_record>                            index_records;
+    };
+
+    std::vector<std::string> get_links(const standardese::markup::document_entity& document)
+    {
+        std::vector<std::string> result;
+        standardese::markup::visit(document, [&](const standardese::markup::entity& e) {
+            if (e.kind() == standardese::markup::entity_kind::documentation_link)
+                if (auto dest = static_cast<const standardese::markup::documentation_link&>(e)
+                                    .unresolved_destination())
+                    result.push_back(dest.value());
+        });
+
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        return result;
+    }
+
+    document_record get_document_record(
+        const standardese::markup::document_entity&                 document,
+        const std::vector<standardese::documentation_registration>& registrations)
+    {
+        document_record result;
+        result.name = document.output_name().name();
+        for (auto& registration : registrations)
+            result.registrations.push_back(registration_record{registration.link_name,
+                                                               registration.id.as_str(),
+                                                               registration.force});
+        result.links = get_links(document);
+        return result;
+    }
+
+    document_record get_document_record(const standardese::markup::document_entity& document)
+    {
+        return get_document_record(document,
+                                   standardese::get_documentation_registrations(document));
+    }
+
+    // the pages are registered together with the document of their file
+    std::vector<document_record> get_document_records(const documents& docs)
+    {
+        std::vector<const standardese::markup::document_entity*> registered;
+        for (auto& doc : docs)
+            registered.push_back(doc.get());
+        auto registrations = standardese::get_documentation_registrations(registered);
+
+        std::vector<document_record> result;
+        for (auto i = 0u; i != docs.size(); ++i)
+            result.push_back(get_document_record(*docs[i], registrations[i]));
+        return result;
+    }
+
+    void sort_unique(std::vector<std::string>& names)
+    {
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+    }
+
+    // inserts the entities and modules documented by comments of the file outside of it,
+    // returns whether or not the file has such comments
+    bool add_remote_targets(std::vector<std::string>&          targets,
+                            const standardese::comment::parser& p, const cppast::cpp_file& file)
+    {
+        auto result = false;
+        for (auto& free : file.unmatched_comments())
+            try
+            {
+                auto comment = standardese::comment::parse(p, free.content, false);
+                if (standardese::comment::is_file(comment.entity))
+                    continue;
+
+                result = true;
+                if (auto entity = standardese::comment::get_remote_entity(comment.entity))
+                    targets.push_back(entity.value());
+                else if (auto module = standardese::comment::get_module(comment.entity))
+                    targets.push_back(module.value());
+            }
+            catch (standardese::comment::parse_error&)
+            {
+                // error is reported when parsing the comments for real,
+                // the comment is ignored then
+                result = true;
+            }
+        sort_unique(targets);
+        return result;
+    }
+
+    // base are the records of the files that haven't been parsed
+    std::vector<file_record> get_records(const pipeline_config& config, const cache* base,
+                                         const std::vector<parsed_file>& parsed)
+    {
+        profile_span span("computing cache records");
+
+        // includes of all files, the parsed files have new information
+        // the includes of skipped files are unknown, so they are scanned
+        auto records = base ? base->records() : std::map<std::string, file_record>();
+        for (auto& file : parsed)
+            if (file.skipped)
+                records.erase(file.file->name());
+            else
+                records[file.file->name()].includes = get_includes(*file.file);
+
+        auto&          p = standardese::comment::get_thread_parser(config.comment_config);
+        key_calculator calculator(records);
+
+        std::vector<file_record> result;
+        for (auto& file : parsed)
+        {
+            file_record record;
+            record.path                = file.file->name();
+            record.key                 = get_key(calculator, config, record.path);
+            record.has_remote_comments = add_remote_targets(record.remote_targets, p, *file.file);
+            record.parse_time          = file.parse_time;
+            if (file.skipped)
+                record.includes =
+                    calculator.get_includes(record.path, get_flags(config, record.path));
+            else
+                record.includes = records.at(record.path).includes;
+            result.push_back(std::move(record));
+        }
+        return result;
+    }
+
+    // estimated cost of parsing each file:
+    // the time it took last time, or the file size if that isn't known for every file
+    std::vector<std::uint64_t> get_costs(const std::set<std::string>& files, const cache* previous)
+    {
+        std::vector<std::uint64_t> result;
+        if (previous)
+        {
+            for (auto& file : files)
+                if (auto record = previous->lookup(file))
+                    result.push_back(record->parse_time);
+                else
+                    break;
+            if (result.size() == files.size())
+                return result;
+        }
+
+        result.clear();
+        for (auto& file : files)
+        {
+            boost::system::error_code ec;
+            auto                      size = fs::file_size(file, ec);
+            result.push_back(ec ? 0u : static_cast<std::uint64_t>(size));
+        }
+        return result;
+    }
+
+    // estimated memory needed to parse each file:
+    // libclang needs a fixed amount and some multiple of the size of the translation unit
+    std::vector<std::uint64_t> get_memory_estimates(const pipeline_config&       config,
+                                                    const std::set<std::string>& files,
+                                                    const cache*                 previous)
+    {
+        std::vector<std::uint64_t> result;
+        if (config.max_memory == 0u)
+        {
+            // not needed without a limit
+            result.resize(files.size());
+            return result;
+        }
+
+        profile_span span("estimating memory");
+
+        // rough numbers, the AST built by libclang is usually a multiple of the source size
+        constexpr std::uint64_t base_memory     = 64u * 1024u * 1024u;
+        constexpr std::uint64_t bytes_per_input = 16u;
+
+        std::map<std::string, file_record> no_records;
+        key_calculator                     calculator(previous ? previous->records() : no_records);
+        for (auto& file : files)
+            result.push_back(base_memory
+                             + bytes_per_input
+                                   * calculator.get_source_size(file, get_flags(config, file)));
+        return result;
+    }
+
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    // returns the files that don't need to be parsed as they don't contain documentation comments
+    std::set<std::string> get_skipped_files(const pipeline_config&       config,
+                                            const std::set<std::string>& files, thread_pool& pool)
+    {
+        std::set<std::string> result;
+        if (!config.skip_uncommented)
+            return result;
+
+        std::mutex                     mutex;
+        auto                           has_remote = false;
+        std::vector<std::future<void>> futures;
+        for (auto& file : files)
+            futures.push_back(add_job(pool, [&] {
+                profile_span span("comment scan", file);
+
+                auto scan = scan_comments(read_file(file), config.comment_config);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (scan == comment_scan::none)
+                    result.insert(file);
+                else if (scan == comment_scan::remote)
+                    has_remote = true;
+            }));
+        wait_for(pool, futures);
+
+        if (has_remote)
+            // the comments might document entities in the skipped files
+            result.clear();
+        return result;
+    }
+
+    std::vector<scheduled_file> schedule_files(const pipeline_config&       config,
+                                               const input_map&             inputs,
+                                               const std::set<std::string>& files,
+                                               const cache* previous, thread_pool& pool)
+    {
+        auto costs   = get_costs(files, previous);
+        auto memory  = get_memory_estimates(config, files, previous);
+        auto skipped = get_skipped_files(config, files, pool);
+
+        std::vector<scheduled_file> result;
+        auto                        cost = costs.begin();
+        auto                        mem  = memory.begin();
+        for (auto& file : files)
+            result.push_back({*inputs.at(file), *cost++, *mem++, skipped.count(file) != 0u});
+        return result;
+    }
+
+    void register_documents(const standardese::linker& linker, const document_record& doc)
+    {
+        for (auto& registration : doc.registrations)
+            linker.register_documentation(registration.link_name,
+                                          standardese::markup::block_reference(
+                                              standardese::markup::output_name::from_name(
+                                                  doc.name),
+                                              standardese::markup::block_id(registration.id)),
+                                          registration.force);
+    }
+
+    // returns the prefix of the output files of each format
+    std::string get_format_prefix(const pipeline_config& config, const char* extension)
+    {
+        return config.formats.size() > 1u ? std::string(extension) + '/' + config.prefix :
+                                            config.prefix;
+    }
+
+    // registers the documents of the previous run of the files that aren't generated again
+    void register_previous_documents(const standardese::linker& linker, const cache& previous,
+                                     const std::set<std::string>& files)
+    {
+        for (auto& pair : previous.records())
+            if (!files.count(pair.first))
+                for (auto& doc : pair.second.documents)
+                    register_documents(linker, doc);
+    }
+
+    void register_references(standardese::synopsis_reference_table&                        table,
+                             const std::vector<std::unique_ptr<standardese::doc_cpp_file>>& files,
+                             thread_pool&                                                   pool)
+    {
+        profile_span span("synopsis references");
+
+        std::vector<std::future<void>> futures;
+        for (auto& file : files)
+            futures.push_back(add_job(pool, [&] { table.register_file(file->file()); }));
+        wait_for(pool, futures);
+    }
+
+    // returns the output formats, creating the directories of their files
+    std::vector<output_format> get_output_formats(const pipeline_config& config)
+    {
+        std::vector<output_format> result;
+        for (auto& format : config.formats)
+        {
+            auto format_prefix = get_format_prefix(config, format.second);
+            if (!format_prefix.empty())
+                fs::create_directories(fs::path(format_prefix).parent_path());
+            result.push_back({format.first, std::move(format_prefix), format.second});
+        }
+        return result;
+    }
+
+    // inserts the base names of the link names the documents of the entity might register,
+    // and the ones the index documents register as well: the namespaces and modules
+    void add_registered_names(std::vector<std::string>& names,
+                              std::vector<std::string>& index_names,
+                              const standardese::doc_entity& entity)
+    {
+        names.push_back(get_base_name(entity.link_name()));
+        if (entity.kind() == standardese::doc_entity::cpp_namespace)
+            index_names.push_back(names.back());
+        if (entity.comment())
+            if (auto& module = entity.comment().value().metadata().module())
+                index_names.push_back(get_base_name(module.value()));
+
+        for (auto& child : entity)
+            add_registered_names(names, index_names, child);
+    }
+
+    // inserts the base names of the link names the index documents register for the entries
+    void add_index_names(std::vector<std::string>&         index_names,
+                         const standardese::index_entries& entries)
+    {
+        for (auto& entry : entries.namespaces)
+            index_names.push_back(get_base_name(entry.doc->id().as_str()));
+        for (auto& module : entries.modules)
+            index_names.push_back(get_base_name(module->id().as_str()));
+    }
+
+    // resolves the links of the documents of each file and writes them
+    // as soon as no file that isn't registered yet might register a link name they use,
+    // then destroys the files that are no longer needed
+    //
+    // A link can only resolve to a link name with the same base name,
+    // and the link names a file might register are known from its doc entities.
+    // The injected doc entities refer to the file of their entity and the other way around,
+    // so files connected by them are only destroyed together.
+    class document_streamer
+    {
+    public:
+        // only the documents of the given files are written,
+        // the index documents register the cached index names as well
+        document_streamer(const pipeline_config& config, generation& gen,
+                          const std::set<std::string>& written, bool generate_indices,
+                          std::vector<std::string> cached_index_names, thread_pool& pool)
+        : gen_(&gen),
+          written_(&written),
+          pool_(&pool),
+          formats_(get_output_formats(config)),
+          names_(gen.files.size()),
+          groups_(gen.files.size()),
+          remaining_(gen.files.size()),
+          members_(gen.files.size())
+        {
+            profile_span span("stream preparation");
+
+            if (generate_indices)
+                index_names_ = std::move(cached_index_names);
+
+            std::vector<std::vector<std::string>> index_names(gen.files.size());
+            std::vector<std::future<void>>        futures;
+            for (auto i = 0u; i != gen.files.size(); ++i)
+                futures.push_back(add_job(pool, [&, i] {
+                    add_registered_names(names_[i], index_names[i], *gen.files[i]);
+                    sort_unique(names_[i]);
+                }));
+            wait_for(pool, futures);
+
+            std::map<const cppast::cpp_file*, std::size_t> file_indices;
+            for (auto i = 0u; i != gen.files.size(); ++i)
+            {
+                indices_.emplace(gen.files[i].get(), i);
+                file_indices.emplace(&gen.files[i]->file(), i);
+                for (auto& name : names_[i])
+                    ++owners_[name];
+                if (generate_indices)
+                    index_names_.insert(index_names_.end(), index_names[i].begin(),
+                                        index_names[i].end());
+            }
+            // they're registered again by the index documents
+            sort_unique(index_names_);
+            for (auto& name : index_names_)
+                ++owners_[name];
+
+            for (auto i = 0u; i != gen.files.size(); ++i)
+                groups_[i] = i;
+            for (auto i = 0u; i != gen.files.size(); ++i)
+                for (auto file : gen.files[i]->get_injected_files())
+                {
+                    auto iter = file_indices.find(file);
+                    if (iter != file_indices.end())
+                        groups_[get_group(i)] = get_group(iter->second);
+                }
+            for (auto i = 0u; i != gen.files.size(); ++i)
+            {
+                groups_[i] = get_group(i);
+                ++remaining_[groups_[i]];
+                members_[groups_[i]].push_back(i);
+            }
+        }
+
+        // called after the documents of the file are registered, possibly concurrently
+        void add(const standardese::doc_cpp_file& file, documents docs)
+        {
+            auto index = indices_.at(&file);
+            if (!written_->count(file.file().name()))
+                docs.clear();
+
+            std::vector<std::string> links;
+            for (auto& doc : docs)
+                for (auto& link : get_links(*doc))
+                    links.push_back(get_base_name(link));
+            sort_unique(links);
+
+            // declared before the lock, so that they're destroyed after it is released
+            std::vector<std::unique_ptr<standardese::doc_cpp_file>> destroyed;
+            std::lock_guard<std::mutex>                             lock(mutex_);
+            for (auto& name : names_[index])
+                --owners_[name];
+            if (docs.empty())
+                finish_file(index, destroyed);
+            else
+                pending_.push_back(pending_file{index, std::move(docs), std::move(links)});
+            schedule_ready();
+        }
+
+        // called after the index documents are registered,
+        // writes the remaining documents and waits until all of them are written
+        void finish()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto& name : index_names_)
+                    --owners_[name];
+                schedule_ready();
+                assert(pending_.empty());
+            }
+            wait_for(*pool_, futures_);
+        }
+
+    private:
+        struct pending_file
+        {
+            std::size_t              index; //< of the file in the generation
+            documents                docs;
+            std::vector<std::string> links; //< base names of the link names used in them
+        };
+
+        std::size_t get_group(std::size_t index)
+        {
+            while (groups_[index] != index)
+                index = groups_[index] = groups_[groups_[index]];
+            return index;
+        }
+
+        bool is_ready(const pending_file& file) const
+        {
+            return std::none_of(file.links.begin(), file.links.end(), [&](const std::string& link) {
+                auto iter = owners_.find(link);
+                return iter != owners_.end() && iter->second != 0u;
+            });
+        }
+
+        // requires the lock
+        void schedule_ready()
+        {
+            auto ready = std::stable_partition(pending_.begin(), pending_.end(),
+                                               [&](const pending_file& file) {
+                                                   return !is_ready(file);
+                                               });
+            for (auto iter = ready; iter != pending_.end(); ++iter)
+            {
+                // the job must be copyable
+                auto file = std::make_shared<pending_file>(std::move(*iter));
+                futures_.push_back(add_job(*pool_, [this, file] { write(*file); }));
+            }
+            pending_.erase(ready, pending_.end());
+        }
+
+        void write(pending_file& file)
+        {
+            for (auto& doc : file.docs)
+            {
+                {
+                    profile_span span("link resolution", doc->output_name().name());
+                    standardese::resolve_links(*cppast::default_logger(), gen_->linker, *doc);
+                }
+                write_document(*doc, formats_);
+            }
+            // they refer to the file
+            file.docs.clear();
+
+            std::vector<std::unique_ptr<standardese::doc_cpp_file>> destroyed;
+            std::lock_guard<std::mutex>                             lock(mutex_);
+            finish_file(file.index, destroyed);
+        }
+
+        // requires the lock, moves the files that aren't needed anymore into destroyed
+        void finish_file(std::size_t                                              index,
+                         std::vector<std::unique_ptr<standardese::doc_cpp_file>>& destroyed)
+        {
+            auto group = groups_[index];
+            if (--remaining_[group] == 0u)
+                for (auto member : members_[group])
+                    destroyed.push_back(std::move(gen_->files[member]));
+        }
+
+        generation*                  gen_;
+        const std::set<std::string>* written_;
+        thread_pool*                 pool_;
+        std::vector<output_format>   formats_;
+
+        std::map<const standardese::doc_cpp_file*, std::size_t> indices_;
+        std::vector<std::vector<std::string>> names_;       //< base names registered by each file
+        std::vector<std::string>              index_names_; //< registered by the index documents
+        std::map<std::string, unsigned> owners_; //< number of registrations that are still missing
+
+        std::vector<std::size_t>              groups_; //< files that are destroyed together
+        std::vector<unsigned>                 remaining_; //< files of the group that aren't done
+        std::vector<std::vector<std::size_t>> members_;   //< files of the group
+
+        std::mutex                     mutex_;
+        std::vector<pending_file>      pending_;
+        std::vector<std::future<void>> futures_;
+    };
+
+    // parses the files and generates their documentation,
+    // only the documents of the written files are kept,
+    // in streaming mode they're written right away and the files destroyed afterwards
+    std::unique_ptr<generation> generate_files(const pipeline_config&       config,
+                                               const input_map&             inputs,
+                                               const std::set<std::string>& files,
+                                               const std::set<std::string>& written,
+                                               bool generate_indices, const cache* previous,
+                                               thread_pool& pool)
+    {
+        auto scheduled = schedule_files(config, inputs, files, previous, pool);
+
+        std::unique_ptr<generation> result(new generation);
+        for (auto& external : config.external_docs)
+            result->linker.register_external(external.first, external.second);
+
+        std::clog << "parsing C++ files and documentation comments...\n";
+        standardese::file_comment_parser comment_parser(cppast::default_logger(),
+                                                        config.comment_config);
+        // the cached comments are kept until all files are parsed, they get a share of the budget
+        auto cache_memory = config.max_memory / 8u;
+        if (config.max_memory != 0u)
+            comment_parser.set_cache_limit(cache_memory);
+        memory_budget budget(config.max_memory - cache_memory);
+        auto parsed = parse(config.compile_config, config.database, scheduled, result->index,
+                            comment_parser, budget, pool);
+        if (!parsed)
+            return nullptr;
+
+        // remote comments can only be matched once all files are parsed
+        result->comments = comment_parser.finish();
+        if (get_profiler().is_enabled())
+            std::clog << "comment cache: " << comment_parser.cache_hits() << " hits, "
+                      << comment_parser.cache_misses() << " misses\n";
+        auto full = files.size() == inputs.size();
+        if (previous)
+            result->records = get_records(config, full ? nullptr : previous, parsed.value());
+
+        // each file is excluded and built in one job, but only after all files are parsed:
+        // a remote comment or the comment of a base class in another file can exclude its entities
+        result->files = build_files(result->comments, result->index, std::move(parsed.value()),
+                                    config.blacklist, pool);
+
+        if (previous && !full)
+            // links to the files that aren't parsed resolve to their documents of the previous run,
+            // they need to be registered before the documents are streamed
+            register_previous_documents(result->linker, *previous, files);
+        if (previous && !generate_indices)
+            for (auto& doc : previous->index_documents())
+                register_documents(result->linker, doc);
+
+        // the index entries of the files that aren't parsed are taken from the previous run
+        std::map<std::string, standardese::index_entries> index_entries; // by file path
+        std::vector<std::string>                          cached_index_names;
+        if (previous && !full && generate_indices)
+        {
+            profile_span span("reading index entries");
+            for (auto& pair : previous->records())
+                if (!files.count(pair.first))
+                {
+                    auto entries = read_index_entries(pair.second.index_entries);
+                    add_index_names(cached_index_names, entries);
+                    index_entries.emplace(pair.first, std::move(entries));
+                }
+            sort_unique(cached_index_names);
+        }
+
+        auto                               syn_config = config.synopsis_config;
+        std::unique_ptr<document_streamer> streamer;
+        if (config.stream)
+        {
+            // the synopsis can't use the doc entities of files that were already destroyed
+            register_references(result->references, result->files, pool);
+            const auto& references = result->references;
+            syn_config.set_references(type_safe::opt_ref(&references));
+
+            streamer.reset(new document_streamer(config, *result, written, generate_indices,
+                                                 std::move(cached_index_names), pool));
+        }
+
+        std::clog << "generating documentation...\n";
+        // note: the records must be computed before the links are resolved,
+        // and before the streamer might destroy the file
+        struct file_output
+        {
+            std::vector<document_record> documents;
+            std::string                  index_entries; //< serialized
+            std::vector<std::string>     modules;
+        };
+        std::mutex                         mutex;
+        std::map<std::string, file_output> outputs; // by file path
+        auto add_documents = [&](const standardese::doc_cpp_file& file, documents docs,
+                                 standardese::index_entries entries) {
+            auto        path = file.file().name();
+            file_output output;
+            if (previous)
+            {
+                output.documents     = get_document_records(docs);
+                output.index_entries = write_index_entries(entries);
+                for (auto& module : entries.modules)
+                    output.modules.push_back(module->id().as_str());
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (previous)
+                    outputs.emplace(path, std::move(output));
+                if (generate_indices)
+                    index_entries[path] = std::move(entries);
+                for (auto& doc : docs)
+                {
+                    result->doc_files.emplace(doc->output_name().name(), path);
+                    if (!streamer && written.count(path))
+                        result->docs.push_back(std::move(doc));
+                }
+            }
+
+            if (streamer)
+                streamer->add(file, std::move(docs));
+        };
+        generate(config.generation_config, syn_config, result->comments, result->index,
+                 result->linker, result->files, config.split_pages, add_documents, pool);
+
+        if (generate_indices)
+        {
+            std::vector<const standardese::index_entries*> entries;
+            for (auto& pair : index_entries)
+                entries.push_back(&pair.second);
+            for (auto& doc :
+                 generate_index_documents(config.generation_config, result->linker, entries, pool))
+            {
+                // they're written afterwards in streaming mode as well, they're only complete now
+                if (previous)
+                    result->index_records.push_back(get_document_record(*doc));
+                result->docs.push_back(std::move(doc));
+            }
+        }
+        if (streamer)
+            streamer->finish();
+
+        for (auto& record : result->records)
+        {
+            auto& output         = outputs.at(record.path);
+            record.documents     = std::move(output.documents);
+            record.index_entries = std::move(output.index_entries);
+            record.modules       = std::move(output.modules);
+        }
+
+        return result;
+    }
+
+    // inserts the base names of all link names registered differently
+    void add_changed_names(std::set<std::string>&              names,
+                           const std::vector<document_record>& old_docs,
+                           const std::vector<document_record>& new_docs)
+    {
+        auto as_strings = [](const std::vector<document_record>& docs) {
+            // an entity might have moved to a different page
+            std::set<std::string> result;
+            for (auto& doc : docs)
+                for (auto& registration : doc.registrations)
+                    result.insert(registration.link_name + '\n' + doc.name + '\n'
+                                  + registration.id + '\n' + (registration.force ? "1" : "0"));
+            return result;
+        };
+
+        auto old_registrations = as_strings(old_docs);
+        auto new_registrations = as_strings(new_docs);
+
+        std::vector<std::string> changed;
+        std::set_symmetric_difference(old_registrations.begin(), old_registrations.end(),
+                                      new_registrations.begin(), new_registrations.end(),
+                                      std::back_inserter(changed));
+        for (auto& registration : changed)
+            names.insert(get_base_name(registration.substr(0, registration.find('\n'))));
+    }
+
+    // whether or not one of the links in the document might resolve differently now
+    bool is_affected(const document_record& doc, const std::set<std::string>& changed_names)
+    {
+        for (auto& link : doc.links)
+            if (changed_names.count(get_base_name(link)))
+                return true;
+        return false;
+    }
+
+    bool is_affected(const std::vector<document_record>& docs,
+                     const std::set<std::string>&        changed_names)
+    {
+        return std::any_of(docs.begin(), docs.end(), [&](const document_record& doc) {
+            return is_affected(doc, changed_names);
+        });
+    }
+
+    // inserts the base names of all link names registered differently than in the cache
+    void add_changed_names(std::set<std::string>& names, const cache& c,
+                           const std::vector<file_record>& records)
+    {
+        for (auto& record : records)
+            if (auto old_record = c.lookup(record.path))
+                add_changed_names(names, old_record->documents, record.documents);
+            else
+                add_changed_names(names, {}, record.documents);
+    }
+
+    // returns the base names of the entities and modules whose remote comments might have changed:
+    // the ones documented by the old and new comments of the files that changed
+    std::set<std::string> get_changed_targets(const cache&                    c,
+                                              const std::vector<file_record>& records)
+    {
+        std::set<std::string> result;
+        auto                  insert = [&](const std::vector<std::string>& targets) {
+            for (auto& target : targets)
+                result.insert(get_base_name(target));
+        };
+        for (auto& record : records)
+        {
+            auto old_record = c.lookup(record.path);
+            if (old_record && old_record->key == record.key)
+                continue;
+
+            insert(record.remote_targets);
+            if (old_record)
+                insert(old_record->remote_targets);
+        }
+        return result;
+    }
+
+    // whether or not the documents of the file might contain one of the targets,
+    // or the file might use one of them as module
+    bool is_documented(const file_record& record, const std::set<std::string>& targets)
+    {
+        for (auto& doc : record.documents)
+            for (auto& registration : doc.registrations)
+                if (targets.count(get_base_name(registration.link_name)))
+                    return true;
+        return std::any_of(record.modules.begin(), record.modules.end(),
+                           [&](const std::string& module) {
+                               return targets.count(get_base_name(module)) != 0u;
+                           });
+    }
+
+    // returns the files that haven't been regenerated but need to be:
+    // the ones whose links might resolve differently now,
+    // and the ones documented by remote comments that might have changed
+    std::set<std::string> get_affected_files(const cache& c, const std::set<std::string>& generated,
+                                             const std::vector<file_record>&     records,
+                                             const std::vector<document_record>& index_records)
+    {
+        std::set<std::string> changed_names;
+        add_changed_names(changed_names, c, records);
+        add_changed_names(changed_names, c.index_documents(), index_records);
+
+        auto targets = get_changed_targets(c, records);
+
+        std::set<std::string> result;
+        for (auto& pair : c.records())
+            if (!generated.count(pair.first)
+                && (is_affected(pair.second.documents, changed_names)
+                    || is_documented(pair.second, targets)))
+                result.insert(pair.first);
+        return result;
+    }
+
+    // returns the names of the files written for a document in all formats
+    std::vector<std::string> get_output_files(const pipeline_config& config,
+                                              const std::string&     name)
+    {
+        std::vector<std::string> result;
+        for (auto& format : config.formats)
+            result.push_back(
+                get_format_prefix(config, format.second)
+                + standardese::markup::output_name::from_name(name).file_name(format.second));
+        return result;
+    }
+
+    // resolves the links of the documents that weren't written while streaming and writes them,
+    // returns the names of the files written for the given files and the index documents
+    std::vector<std::string> write_documents(const pipeline_config& config, generation& gen,
+                                             const std::set<std::string>& files, thread_pool& pool)
+    {
+        std::vector<std::string> names;
+        for (auto& pair : gen.doc_files)
+            if (files.count(pair.second))
+                names.push_back(pair.first);
+        for (auto& doc : gen.docs)
+            if (!gen.doc_files.count(doc->output_name().name()))
+                // index document
+                names.push_back(doc->output_name().name());
+
+        std::vector<std::string> outputs;
+        for (auto& name : names)
+        {
+            auto files = get_output_files(config, name);
+            outputs.insert(outputs.end(), files.begin(), files.end());
+        }
+
+        auto formats = get_output_formats(config);
+        resolve_links(gen.linker, gen.docs, pool);
+
+        std::clog << "writing files...\n";
+        write_files(gen.docs, formats, pool);
+        return outputs;
+    }
+
+    // returns the outputs of the cache after the given files were generated again:
+    // they can have new documents or lose some, like the pages of added or removed classes
+    std::vector<std::string> update_outputs(const pipeline_config& config, const cache& c,
+                                            const std::set<std::string>&    files,
+                                            const std::vector<file_record>& records,
+                                            const std::vector<std::string>& written)
+    {
+        std::set<std::string> removed;
+        for (auto& file : files)
+            if (auto record = c.lookup(file))
+                for (auto& doc : record->documents)
+                    removed.insert(doc.name);
+        for (auto& record : records)
+            for (auto& doc : record.documents)
+                removed.erase(doc.name);
+
+        std::set<std::string> result(c.outputs().begin(), c.outputs().end());
+        for (auto& name : removed)
+            for (auto& output : get_output_files(config, name))
+                result.erase(output);
+        result.insert(written.begin(), written.end());
+        return std::vector<std::string>(result.begin(), result.end());
+    }
+
+    // generates the index documents from the index entries in the cache and writes them,
+    // updates the cache and returns the files whose links might resolve differently now
+    std::set<std::string> write_index_documents(const pipeline_config& config, cache& c,
+                                                thread_pool& pool)
+    {
+        standardese::linker linker;
+        for (auto& external : config.external_docs)
+            linker.register_external(external.first, external.second);
+        register_previous_documents(linker, c, {});
+
+        std::vector<standardese::index_entries> entries;
+        {
+            profile_span span("reading index entries");
+            for (auto& pair : c.records())
+                entries.push_back(read_index_entries(pair.second.index_entries));
+        }
+        std::vector<const standardese::index_entries*> pointers;
+        for (auto& file_entries : entries)
+            pointers.push_back(&file_entries);
+        auto docs = generate_index_documents(config.generation_config, linker, pointers, pool);
+
+        std::vector<document_record> records;
+        for (auto& doc : docs)
+            records.push_back(get_document_record(*doc));
+        std::set<std::string> changed_names;
+        add_changed_names(changed_names, c.index_documents(), records);
+
+        std::vector<std::string> outputs(c.outputs());
+        for (auto& doc : docs)
+        {
+            auto files = get_output_files(config, doc->output_name().name());
+            outputs.insert(outputs.end(), files.begin(), files.end());
+        }
+        sort_unique(outputs);
+
+        auto formats = get_output_formats(config);
+        resolve_links(linker, docs, pool);
+
+        std::clog << "writing files...\n";
+        write_files(docs, formats, pool);
+
+        c.set_outputs(std::move(outputs));
+        c.set_index_documents(std::move(records));
+
+        std::set<std::string> result;
+        for (auto& pair : c.records())
+            if (is_affected(pair.second.documents, changed_names))
+                result.insert(pair.first);
+        return result;
+    }
+
+    // generates the dirty files and all files affected by them, and updates the cache
+    bool regenerate(const pipeline_config& config, const input_map& inputs,
+                    type_safe::optional_ref<cache> c, std::set<std::string> dirty,
+                    thread_pool& pool)
+    {
+        for (auto first = true;; first = false)
+        {
+            if (!first)
+                std::clog << "links changed, regenerating more files...\n";
+
+            auto files =
+                dirty.size() == inputs.size() ? dirty : get_parse_set(dirty, inputs, c.value());
+            auto full  = files.size() == inputs.size();
+
+            // the documents that weren't generated again are registered as well,
+            // the index documents use their cached index entries
+            auto result = generate_files(config, inputs, files, files, true,
+                                         c ? &c.value() : nullptr, pool);
+            if (!result)
+                return false;
+
+            if (!full)
+            {
+                // in streaming mode the documents were already written,
+                // they're written again together with the affected files
+                auto affected =
+                    get_affected_files(c.value(), files, result->records, result->index_records);
+                if (!affected.empty())
+                {
+                    dirty.insert(affected.begin(), affected.end());
+                    continue;
+                }
+            }
+
+            auto outputs = write_documents(config, *result, files, pool);
+
+            if (c)
+            {
+                profile_span span("updating cache");
+                if (full)
+                {
+                    c.value().clear();
+                    c.value().set_options(config.options);
+                    c.value().set_outputs(std::move(outputs));
+                }
+                else
+                    c.value().set_outputs(
+                        update_outputs(config, c.value(), files, result->records, outputs));
+                c.value().set_index_documents(std::move(result->index_records));
+
+                for (auto& record : result->records)
+                    c.value().add_record(std::move(record));
+                c.value().save();
+            }
+
+            return true;
+        }
+    }
+
+    // returns the files of the shard, the input files are distributed in order of their path
+    std::set<std::string> get_shard_files(const input_map& inputs, const shard& s)
+    {
+        std::set<std::string> result;
+        auto                  i = 0u;
+        for (auto& pair : inputs)
+            if (i++ % s.count == s.index)
+                result.insert(pair.first);
+        return result;
+    }
+
+    // returns the files that need to be parsed in order to generate the files of a shard:
+    // its files, all input files they include and all files that might have remote comments
+    std::set<std::string> get_shard_parse_set(const pipeline_config& config,
+                                              const input_map&       inputs,
+                                              const std::set<std::string>& files,
+                                              const cache& previous, thread_pool& pool)
+    {
+        std::vector<std::string> stack(files.begin(), files.end());
+
+        // the previous run might not know about all files, so scan them
+        std::mutex                     mutex;
+        std::vector<std::future<void>> futures;
+        for (auto& pair : inputs)
+            futures.push_back(add_job(pool, [&] {
+                if (scan_comments(read_file(pair.first), config.comment_config)
+                    == comment_scan::remote)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stack.push_back(pair.first);
+                }
+            }));
+        wait_for(pool, futures);
+
+        std::set<std::string> result;
+        key_calculator        calculator(previous.records());
+        while (!stack.empty())
+        {
+            auto cur = std::move(stack.back());
+            stack.pop_back();
+            if (!inputs.count(cur) || !result.insert(cur).second)
+                continue;
+
+            for (auto& include : calculator.get_includes(cur, get_flags(config, cur)))
+                stack.push_back(include);
+        }
+        return result;
+    }
+} // namespace
+
+std::string standardese_tool::get_base_name(const std::string& link_name)
+{
+    std::string name;
+    for (auto c : link_name)
+        if (c != ' ')
+            name += c;
+    if (!name.empty() && (name.front() == '*' || name.front() == '?'))
+        // relative link name
+        name.erase(0, 1);
+
+    // find the beginning of the last component that isn't nested in a signature or template
+    auto begin = std::string::size_type(0);
+    auto depth = 0u;
+    for (auto i = std::string::size_type(0); i != name.size(); ++i)
+    {
+        auto c = name[i];
+        if (c == '(' || c == '<')
+            ++depth;
+        else if ((c == ')' || c == '>') && depth > 0u)
+            --depth;
+        else if (depth == 0u && (c == ':' || c == '.'))
+            begin = i + 1u;
+    }
+
+    auto end = name.find_first_of("(<", begin);
+    return name.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+bool standardese_tool::run_pipeline(const pipeline_config& config,
+                                    const std::vector<input_file>& input,
+                                    type_safe::optional_ref<cache> c, bool incremental)
+{
+    auto inputs = get_input_map(input);
+
+    auto dirty = c ? get_dirty_files(config, inputs, c.value()) : get_all_files(inputs);
+    if (c && dirty.empty())
+    {
+        std::clog << "documentation is up to date\n";
+        return true;
+    }
+    else if (!incremental)
+        dirty = get_all_files(inputs);
+
+    // shared by all stages, so that no threads are started and stopped in between
+    thread_pool pool(config.no_threads);
+    return regenerate(config, inputs, c, std::move(dirty), pool);
+}
+
+fs::path standardese_tool::get_shard_directory(const fs::path& cache_dir, const shard& s)
+{
+    return cache_dir / ("shard-" + std::to_string(s.index) + "-of-" + std::to_string(s.count));
+}
+
+bool standardese_tool::run_shard(const pipeline_config&         config,
+                                 const std::vector<input_file>& input, const cache& previous,
+                                 cache& partial, const shard& s)
+{
+    auto inputs = get_input_map(input);
+    auto own    = get_shard_files(inputs, s);
+
+    // the previous run can only be used if it had the same options
+    cache empty;
+    auto& base = previous.options() == config.options ? previous : empty;
+
+    thread_pool pool(config.no_threads);
+
+    // only write the documents of the shard, the other parsed files belong to different shards,
+    // links to the other shards resolve to their documents as of the previous run,
+    // the merge takes care of the ones that changed since then
+    auto files  = get_shard_parse_set(config, inputs, own, base, pool);
+    auto result = generate_files(config, inputs, files, own, false, &base, pool);
+    if (!result)
+        return false;
+
+    auto outputs = write_documents(config, *result, own, pool);
+
+    std::vector<file_record> records;
+    for (auto& record : result->records)
+        if (own.count(record.path))
+            records.push_back(std::move(record));
+
+    profile_span span("updating cache");
+    partial.clear();
+    partial.set_options(config.options);
+    partial.set_outputs(std::move(outputs));
+    for (auto& record : records)
+        partial.add_record(std::move(record));
+    partial.save();
+
+    return true;
+}
+
+bool standardese_tool::merge_shards(const pipeline_config&         config,
+                                    const std::vector<input_file>& input, cache& c,
+                                    const std::vector<cache>& shards)
+{
+    auto inputs = get_input_map(input);
+
+    auto                     complete = true;
+    std::vector<file_record> records;
+    std::vector<std::size_t> record_shards; // index of the shard of each record
+    std::vector<std::string> outputs(c.outputs());
+    for (auto i = 0u; i != shards.size(); ++i)
+    {
+        complete = complete && shards[i].options() == config.options;
+        for (auto& pair : shards[i].records())
+        {
+            records.push_back(pair.second);
+            record_shards.push_back(i);
+        }
+        outputs.insert(outputs.end(), shards[i].outputs().begin(), shards[i].outputs().end());
+    }
+    std::sort(outputs.begin(), outputs.end());
+    outputs.erase(std::unique(outputs.begin(), outputs.end()), outputs.end());
+
+    // the shards used the previous run unless it had different options
+    cache empty;
+    auto& base = c.options() == config.options ? c : empty;
+
+    // the documents whose links might resolve differently than in their shard:
+    // the links to link names that another shard registered differently than the previous run
+    std::set<std::string> dirty;
+    if (!complete)
+        dirty = get_all_files(inputs);
+    else
+    {
+        std::map<std::string, std::set<std::size_t>> changed; // base name and shards changing it
+        for (auto i = 0u; i != records.size(); ++i)
+        {
+            std::set<std::string> names;
+            if (auto old_record = base.lookup(records[i].path))
+                add_changed_names(names, old_record->documents, records[i].documents);
+            else
+                add_changed_names(names, {}, records[i].documents);
+            for (auto& name : names)
+                changed[name].insert(record_shards[i]);
+        }
+
+        auto changed_elsewhere = [&](const std::string& link, std::size_t shard) {
+            auto iter = changed.find(get_base_name(link));
+            return iter != changed.end()
+                   && (iter->second.size() > 1u || !iter->second.count(shard));
+        };
+        for (auto i = 0u; i != records.size(); ++i)
+            for (auto& doc : records[i].documents)
+                if (std::any_of(doc.links.begin(), doc.links.end(), [&](const std::string& link) {
+                        return changed_elsewhere(link, record_shards[i]);
+                    }))
+                    dirty.insert(records[i].path);
+    }
+
+    // the index documents are generated from the index entries of the shards
+    auto index_changed = c.options() != config.options || c.records().size() != records.size()
+                         || std::any_of(records.begin(), records.end(),
+                                        [&](const file_record& record) {
+                                            auto old_record = c.lookup(record.path);
+                                            return !old_record
+                                                   || old_record->index_entries
+                                                          != record.index_entries;
+                                        });
+
+    // the shards replace the previous run, its index documents are replaced if they changed
+    auto index_documents = c.index_documents();
+    c.clear();
+    c.set_options(complete ? config.options : 0u);
+    c.set_outputs(std::move(outputs));
+    c.set_index_documents(std::move(index_documents));
+    for (auto& record : records)
+        c.add_record(std::move(record));
+
+    // files that changed after their shard was generated
+    auto changed = get_dirty_files(config, inputs, c);
+    dirty.insert(changed.begin(), changed.end());
+
+    thread_pool pool(config.no_threads);
+    if (dirty.empty() && index_changed)
+        // no file needs to be parsed for them
+        dirty = write_index_documents(config, c, pool);
+    if (dirty.empty())
+    {
+        std::clog << "merged documentation is up to date\n";
+        c.save();
+        return true;
+    }
+
+    return regenerate(config, inputs, type_safe::opt_ref(&c), std::move(dirty), pool);
+}
@@ -0,0 +1,87 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef STANDARDESE_TOOL_PIPELINE_HPP_INCLUDED
+#define STANDARDESE_TOOL_PIPELINE_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <type_safe/optional_ref.hpp>
+
+#include "cache.hpp"
+#include "generator.hpp"
+
+namespace standardese_tool
+{
+    /// Everything needed to generate the documentation.
+    struct pipeline_config
+    {
+        cppast::libclang_compile_config                            compile_config;
+        type_safe::optional<cppast::libclang_compilation_database> database;
+
+        standardese::comment::config   comment_config;
+        standardese::synopsis_config   synopsis_config;
+        standardese::generation_config generation_config;
+        standardese::entity_blacklist  blacklist;
+
+        bool skip_uncommented; //< whether files without documentation comments aren't parsed
+        bool split_pages;      //< whether classes, namespaces and sections get their own document
+
+        std::vector<std::pair<std::string, std::string>> external_docs; //< namespace name and URL
+        std::vector<std::pair<standardese::markup::generator, const char*>> formats;
+        std::string                                                         prefix;
+
+        std::uint64_t options; //< fingerprint of all options affecting the output
+        unsigned      no_threads;
+        std::uint64_t max_memory; //< memory available for parsing in bytes, `0` for no limit
+        bool          stream; //< whether each file is destroyed once its documents are written
+    };
+
+    /// \returns The last component of the link name without template arguments or signature.
+    /// If a link can resolve to a registered link name, both have the same base name.
+    std::string get_base_name(const std::string& link_name);
+
+    /// \effects Generates the documentation for the input files and writes it.
+    ///
+    /// If a cache is given, nothing will be done if no input file changed since the last run,
+    /// and the cache is updated afterwards.
+    /// If `incremental` is `true` as well,
+    /// only the documents whose inputs or link targets changed are regenerated.
+    /// \returns `false` if a file couldn't be parsed, `true` otherwise.
+    bool run_pipeline(const pipeline_config& config, const std::vector<input_file>& input,
+                      type_safe::optional_ref<cache> c, bool incremental);
+
+    /// One of multiple parts of the input files,
+    /// so that the documentation can be generated by separate processes.
+    struct shard
+    {
+        unsigned index; //< zero-based index of the part
+        unsigned count; //< total number of parts
+    };
+
+    /// \returns The directory in the cache directory where the results of the shard are stored.
+    fs::path get_shard_directory(const fs::path& cache_dir, const shard& s);
+
+    /// \effects Generates and writes the documentation of the input files belonging to the shard,
+    /// the files are distributed among the shards by their path.
+    /// Links to files of other shards are resolved using the previous run,
+    /// the records of the generated files are stored in the partial cache.
+    /// The index documents are not generated.
+    /// \returns `false` if a file couldn't be parsed, `true` otherwise.
+    bool run_shard(const pipeline_config& config, const std::vector<input_file>& input,
+                   const cache& previous, cache& partial, const shard& s);
+
+    /// \effects Combines the results of all shards into the cache,
+    /// and regenerates the documents whose links might resolve differently now.
+    /// The index documents are generated from the index entries the shards stored in their records,
+    /// so no file is parsed if only they changed.
+    /// \returns `false` if a file couldn't be parsed, `true` otherwise.
+    bool merge_shards(const pipeline_config& config, const std::vector<input_file>& input, cache& c,
+                      const std::vector<cache>& shards);
+} // namespace standardese_tool
+
+#endif // STANDARDESE_TOOL_PIPELINE_HPP_INCLUDED
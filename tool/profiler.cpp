@@ -0,0 +1,84 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "profiler.hpp"
+
+#include <cstdio>
+
+using namespace standardese_tool;
+
+namespace
+{
+    // small ids are easier to read in the trace viewer than std::thread::id
+    unsigned get_thread_id() noexcept
+    {
+        static std::atomic<unsigned> next_id(0u);
+        thread_local unsigned        id = next_id++;
+        return id;
+    }
+
+    std::uint64_t get_microseconds(profiler::clock::duration d) noexcept
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    }
+
+    void write_string(std::ostream& out, const std::string& str)
+    {
+        out << '"';
+        for (auto c : str)
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char buffer[8];
+                std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                out << buffer;
+            }
+            else
+                out << c;
+        out << '"';
+    }
+} // namespace
+
+void profiler::record(const char* stage, std::string detail, clock::time_point begin,
+                      clock::time_point end)
+{
+    span s{stage, std::move(detail), get_microseconds(begin - start_),
+           get_microseconds(end - begin), get_thread_id()};
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    spans_.push_back(std::move(s));
+}
+
+void profiler::write(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    out << "{\"traceEvents\":[\n";
+    for (auto iter = spans_.begin(); iter != spans_.end(); ++iter)
+    {
+        if (iter != spans_.begin())
+            out << ",\n";
+
+        out << "{\"name\":";
+        write_string(out, iter->stage);
+        out << ",\"cat\":\"standardese\",\"ph\":\"X\",\"pid\":0,\"tid\":" << iter->thread
+            << ",\"ts\":" << iter->begin << ",\"dur\":" << iter->duration;
+        if (!iter->detail.empty())
+        {
+            out << ",\"args\":{\"detail\":";
+            write_string(out, iter->detail);
+            out << '}';
+        }
+        out << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+profiler& standardese_tool::get_profiler() noexcept
+{
+    static profiler p;
+    return p;
+}
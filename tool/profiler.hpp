@@ -0,0 +1,94 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef STANDARDESE_TOOL_PROFILER_HPP_INCLUDED
+#define STANDARDESE_TOOL_PROFILER_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace standardese_tool
+{
+    /// Records how long each stage took on each thread.
+    ///
+    /// It does nothing until it is enabled.
+    class profiler
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        profiler() : start_(clock::now()), enabled_(false) {}
+
+        profiler(const profiler&) = delete;
+        profiler& operator=(const profiler&) = delete;
+
+        void enable() noexcept
+        {
+            enabled_ = true;
+        }
+
+        bool is_enabled() const noexcept
+        {
+            return enabled_;
+        }
+
+        /// \effects Records that the calling thread spent the given time in the stage,
+        /// `detail` is the file or document it worked on, if any.
+        void record(const char* stage, std::string detail, clock::time_point begin,
+                    clock::time_point end);
+
+        /// \effects Writes all recorded spans as Chrome trace event JSON,
+        /// which can be viewed with `chrome://tracing`.
+        void write(std::ostream& out) const;
+
+    private:
+        struct span
+        {
+            const char*   stage;
+            std::string   detail;
+            std::uint64_t begin, duration; //< in microseconds
+            unsigned      thread;
+        };
+
+        mutable std::mutex mutex_;
+        std::vector<span>  spans_;
+        clock::time_point  start_;
+        std::atomic<bool>  enabled_;
+    };
+
+    /// \returns The profiler used by the tool.
+    profiler& get_profiler() noexcept;
+
+    /// Records the time from its construction to its destruction.
+    class profile_span
+    {
+    public:
+        explicit profile_span(const char* stage, std::string detail = "")
+        : stage_(stage), detail_(std::move(detail)), begin_(profiler::clock::now())
+        {
+        }
+
+        ~profile_span() noexcept
+        {
+            auto& p = get_profiler();
+            if (p.is_enabled())
+                p.record(stage_, std::move(detail_), begin_, profiler::clock::now());
+        }
+
+        profile_span(const profile_span&) = delete;
+        profile_span& operator=(const profile_span&) = delete;
+
+    private:
+        const char*                 stage_;
+        std::string                 detail_;
+        profiler::clock::time_point begin_;
+    };
+} // namespace standardese_tool
+
+#endif // STANDARDESE_TOOL_PROFILER_HPP_INCLUDED
@@ -0,0 +1,188 @@
+// Copyright (C) 2016-2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "thread_pool.hpp"
+
+using namespace standardese_tool;
+
+namespace
+{
+    // the pool and worker index of the current thread, if it is a worker thread
+    thread_local const thread_pool* current_pool   = nullptr;
+    thread_local std::size_t        current_worker = 0u;
+} // namespace
+
+thread_pool::thread_pool(unsigned no_threads)
+: sequence_(0u), pending_(0u), events_(0u), stop_(false)
+{
+    // the waiting thread runs jobs as well
+    auto no_workers = no_threads > 1u ? no_threads - 1u : 0u;
+    for (auto i = 0u; i != no_workers; ++i)
+        workers_.emplace_back(new worker);
+    for (auto i = std::size_t(0); i != workers_.size(); ++i)
+        threads_.emplace_back([this, i] { run_worker(i); });
+}
+
+thread_pool::~thread_pool() noexcept
+{
+    while (run_pending())
+        ;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void thread_pool::schedule(std::function<void()> job, std::uint64_t cost)
+{
+    // increment first, so that pending_ never underflows
+    ++pending_;
+
+    if (current_pool == this)
+    {
+        // nested job, will be run by the current worker unless someone steals it
+        auto& w = *workers_[current_worker];
+        {
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.jobs.push_back(std::move(job));
+        }
+        // synchronize with the condition variable, so the notification isn't lost
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++events_;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push({std::move(job), cost, sequence_++});
+        ++events_;
+    }
+
+    cv_.notify_one();
+    // a waiting thread can run it as well
+    event_cv_.notify_all();
+}
+
+bool thread_pool::run_pending()
+{
+    std::function<void()> job;
+    if (!pop_job(current_pool == this ? current_worker : workers_.size(), job))
+        return false;
+
+    job();
+    finish_job();
+    return true;
+}
+
+void thread_pool::wait_for_event(std::uint64_t events)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    event_cv_.wait(lock, [&] { return events_ != events; });
+}
+
+void thread_pool::finish_job()
+{
+    {
+        // the future of the job is ready now
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++events_;
+    }
+    event_cv_.notify_all();
+}
+
+void thread_pool::run_worker(std::size_t index)
+{
+    current_pool   = this;
+    current_worker = index;
+
+    while (true)
+    {
+        std::function<void()> job;
+        if (pop_job(index, job))
+        {
+            job();
+            finish_job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return stop_ || pending_ != 0u; });
+        if (stop_ && pending_ == 0u)
+            return;
+    }
+}
+
+bool thread_pool::pop_job(std::size_t index, std::function<void()>& job)
+{
+    if (index < workers_.size())
+    {
+        // newest job of the own deque first, it is most likely related to the current one
+        auto&                       w = *workers_[index];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (!w.jobs.empty())
+        {
+            job = std::move(w.jobs.back());
+            w.jobs.pop_back();
+            --pending_;
+            return true;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!queue_.empty())
+        {
+            job = queue_.top().job;
+            queue_.pop();
+            --pending_;
+            return true;
+        }
+    }
+
+    // steal the oldest job of another worker
+    for (auto i = std::size_t(1); i <= workers_.size(); ++i)
+    {
+        auto&                       w = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(w.mutex);
+        if (!w.jobs.empty())
+        {
+            job = std::move(w.jobs.front());
+            w.jobs.pop_front();
+            --pending_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::uint64_t memory_budget::acquire(std::uint64_t bytes)
+{
+    if (limit_ == 0u)
+        return 0u;
+
+    // a job that needs more than the limit can still run on its own
+    bytes = std::min(bytes, limit_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return used_ + bytes <= limit_; });
+    used_ += bytes;
+    return bytes;
+}
+
+void memory_budget::release(std::uint64_t bytes) noexcept
+{
+    if (bytes == 0u)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        used_ -= bytes;
+    }
+    cv_.notify_all();
+}
@@ -5,26 +5,188 @@
 #ifndef STANDARDESE_THREAD_POOL_HPP_INCLUDED
 #define STANDARDESE_THREAD_POOL_HPP_INCLUDED
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <future>
-#include <vector>
+#include <memory>
+#include <mutex>
+#include <queue>
 #include <thread>
-
-#include <ThreadPool.h>
+#include <vector>
 
 namespace standardese_tool
 {
-    using thread_pool = ::ThreadPool;
+    /// A work-stealing thread pool.
+    ///
+    /// Jobs added from outside the pool are started in order of decreasing cost,
+    /// so that long jobs don't end up running alone at the end.
+    /// Jobs added by a job are pushed to the deque of the worker thread running it,
+    /// idle workers steal them from the other end.
+    /// A thread waiting for a job runs pending jobs in the meantime,
+    /// so jobs can wait for nested jobs without blocking a worker.
+    class thread_pool
+    {
+    public:
+        /// \effects Creates a pool that runs jobs on `no_threads` threads:
+        /// `no_threads - 1` worker threads and the thread waiting for the jobs.
+        explicit thread_pool(unsigned no_threads);
+
+        /// \effects Runs all remaining jobs and stops the worker threads.
+        ~thread_pool() noexcept;
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /// \effects Schedules the job.
+        /// \notes The job must not throw.
+        void schedule(std::function<void()> job, std::uint64_t cost);
+
+        /// \effects Runs one pending job on the calling thread, if there is any.
+        /// \returns Whether or not a job was run.
+        bool run_pending();
+
+        /// \effects Runs pending jobs until the future is ready.
+        template <typename T>
+        void wait(const std::future<T>& future)
+        {
+            while (!is_ready(future))
+            {
+                // read before looking for jobs, so no event afterwards is missed
+                auto events = events_.load();
+                if (!run_pending() && !is_ready(future))
+                    // the remaining jobs are running on other threads
+                    wait_for_event(events);
+            }
+        }
+
+    private:
+        struct queued_job
+        {
+            std::function<void()> job;
+            std::uint64_t         cost;
+            std::uint64_t         sequence; //< jobs with the same cost run in order
+
+            bool operator<(const queued_job& other) const noexcept
+            {
+                // priority queue returns the greatest element
+                return cost == other.cost ? sequence > other.sequence : cost < other.cost;
+            }
+        };
+
+        struct worker
+        {
+            std::mutex                        mutex;
+            std::deque<std::function<void()>> jobs;
+        };
+
+        template <typename T>
+        static bool is_ready(const std::future<T>& future)
+        {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
+        // blocks until a job was scheduled or finished since `events` was read
+        void wait_for_event(std::uint64_t events);
+
+        void finish_job();
+
+        void run_worker(std::size_t index);
+
+        bool pop_job(std::size_t index, std::function<void()>& job);
+
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::vector<std::thread>             threads_;
+
+        std::mutex                      mutex_;
+        std::condition_variable         cv_;
+        std::condition_variable         event_cv_; //< notifies threads waiting for a future
+        std::priority_queue<queued_job> queue_;
+        std::uint64_t                   sequence_;
+        std::atomic<std::size_t>        pending_;
+        std::atomic<std::uint64_t>      events_; //< number of jobs scheduled or finished
+        bool                            stop_;
+    };
+
+    /// Limits the memory used by the jobs running at the same time.
+    class memory_budget
+    {
+    public:
+        /// \effects Creates a budget of the given number of bytes,
+        /// `0` means that there is no limit.
+        explicit memory_budget(std::uint64_t limit) noexcept : limit_(limit), used_(0u) {}
+
+        memory_budget(const memory_budget&) = delete;
+        memory_budget& operator=(const memory_budget&) = delete;
+
+        /// \effects Blocks until the given number of bytes is available and reserves them.
+        /// If it is more than the limit, waits until nothing else is reserved.
+        /// \returns The number of bytes reserved, it must be passed to `release()`.
+        std::uint64_t acquire(std::uint64_t bytes);
+
+        void release(std::uint64_t bytes) noexcept;
+
+    private:
+        std::mutex              mutex_;
+        std::condition_variable cv_;
+        std::uint64_t           limit_, used_;
+    };
+
+    /// Reserves memory from a budget while it is alive.
+    class memory_reservation
+    {
+    public:
+        memory_reservation(memory_budget& budget, std::uint64_t bytes)
+        : budget_(&budget), bytes_(budget.acquire(bytes))
+        {
+        }
+
+        ~memory_reservation() noexcept
+        {
+            budget_->release(bytes_);
+        }
+
+        memory_reservation(const memory_reservation&) = delete;
+        memory_reservation& operator=(const memory_reservation&) = delete;
+
+    private:
+        memory_budget* budget_;
+        std::uint64_t  bytes_;
+    };
 
     inline unsigned default_no_threads()
     {
         return std::max(std::thread::hardware_concurrency(), 1u);
     }
 
-    template <typename Fnc, typename... Args>
-    auto add_job(thread_pool& p, Fnc f, Args&&... args)
-        -> std::future<typename std::result_of<Fnc(Args...)>::type>
+    /// \effects Schedules the function in the pool,
+    /// jobs with a higher cost estimate are started first.
+    /// \returns The future to its result.
+    template <typename Fnc>
+    auto add_job(thread_pool& p, Fnc f, std::uint64_t cost = 0u) -> std::future<decltype(f())>
+    {
+        using result_type = decltype(f());
+
+        // std::function requires a copyable function
+        auto task   = std::make_shared<std::packaged_task<result_type()>>(std::move(f));
+        auto result = task->get_future();
+        p.schedule([task] { (*task)(); }, cost);
+        return result;
+    }
+
+    /// \effects Waits until all jobs are finished and rethrows the first exception, if any.
+    template <typename T>
+    void wait_for(thread_pool& p, std::vector<std::future<T>>& futures)
     {
-        return p.enqueue(f, std::forward<Args>(args)...);
+        // wait for all before rethrowing, the jobs might refer to local variables
+        for (auto& future : futures)
+            p.wait(future);
+        for (auto& future : futures)
+            future.get();
     }
 } // namespace standardese_tool
 
@@ -0,0 +1,159 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "watcher.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace standardese_tool;
+
+#ifdef __linux__
+
+namespace
+{
+    // time to wait for further changes after the first one
+    constexpr auto debounce_ms = 100;
+
+    // the canonical path of a file that might not exist anymore
+    std::string get_watched_path(const fs::path& path)
+    {
+        auto absolute = fs::absolute(path);
+        auto parent   = absolute.parent_path();
+        if (!fs::is_directory(parent))
+            return absolute.generic_string();
+        return (fs::canonical(parent) / absolute.filename()).generic_string();
+    }
+} // namespace
+
+file_watcher::file_watcher(const std::set<std::string>& directories, const cache& c)
+: cache_(&c), fd_(inotify_init1(IN_CLOEXEC))
+{
+    if (fd_ < 0)
+        throw std::runtime_error("unable to watch for file system events");
+
+    for (auto& dir : directories)
+    {
+        auto wd =
+            inotify_add_watch(fd_, dir.c_str(),
+                              IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+        if (wd >= 0)
+            // ignore errors, the directory might not exist anymore
+            directories_.emplace(wd, dir);
+    }
+}
+
+file_watcher::~file_watcher() noexcept
+{
+    close(fd_);
+}
+
+void file_watcher::wait()
+{
+    // the outputs of the last run are only known once it is finished
+    ignored_.clear();
+    for (auto& output : cache_->outputs())
+        ignored_.insert(get_watched_path(output));
+    ignored_directory_ =
+        cache_->directory().empty() ? "" : get_watched_path(cache_->directory()) + '/';
+
+    // block until the first event that wasn't caused by writing the documentation
+    while (!read_events())
+        ;
+
+    // editors usually perform multiple operations when saving a file,
+    // so wait until nothing happens anymore
+    pollfd fd{fd_, POLLIN, 0};
+    while (poll(&fd, 1, debounce_ms) > 0)
+        read_events();
+}
+
+bool file_watcher::read_events()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    auto size = read(fd_, buffer, sizeof(buffer));
+    if (size < 0 && errno != EINTR)
+        throw std::runtime_error("unable to read file system events");
+
+    auto result = false;
+    for (auto cur = buffer; cur < buffer + (size > 0 ? size : 0);)
+    {
+        auto& event = *reinterpret_cast<const inotify_event*>(cur);
+        cur += sizeof(inotify_event) + event.len;
+
+        auto dir = directories_.find(event.wd);
+        if (dir == directories_.end() || event.len == 0u)
+            // events were lost or the directory itself changed
+            result = true;
+        else if ((event.mask & (IN_DELETE | IN_MOVED_FROM)) != 0u)
+            // deleting an output makes the cache invalid
+            result = true;
+        else if (!is_ignored(dir->second + '/' + event.name))
+            result = true;
+    }
+    return result;
+}
+
+bool file_watcher::is_ignored(const std::string& path) const
+{
+    if (!ignored_directory_.empty()
+        && path.compare(0u, ignored_directory_.size(), ignored_directory_) == 0)
+        return true;
+    return ignored_.count(path) != 0u;
+}
+
+#else
+
+file_watcher::file_watcher(const std::set<std::string>&, const cache& c) : cache_(&c), fd_(-1)
+{
+    throw std::runtime_error("watching files is only supported on Linux");
+}
+
+file_watcher::~file_watcher() noexcept {}
+
+void file_watcher::wait() {}
+
+#endif
+
+std::set<std::string> standardese_tool::get_watched_directories(
+    const std::vector<fs::path>& input_paths, const std::vector<input_file>& input,
+    const cache& c)
+{
+    std::set<std::string> result;
+
+    auto add_dir = [&](const fs::path& path) {
+        if (fs::is_directory(path))
+            result.insert(fs::canonical(path).generic_string());
+    };
+
+    // to detect new files
+    for (auto& path : input_paths)
+        if (fs::is_directory(path))
+        {
+            add_dir(path);
+            for (auto iter = fs::recursive_directory_iterator(path);
+                 iter != fs::recursive_directory_iterator(); ++iter)
+                if (iter->path().filename().generic_string()[0] == '.')
+                    // don't watch version control directories etc.
+                    iter.no_push();
+                else
+                    add_dir(iter->path());
+        }
+
+    // to detect changed files
+    for (auto& file : input)
+        add_dir(fs::absolute(file.path).parent_path());
+    for (auto& record : c.records())
+        for (auto& include : record.second.includes)
+            add_dir(fs::path(include).parent_path());
+
+    return result;
+}
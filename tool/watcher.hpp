@@ -0,0 +1,59 @@
+// Copyright (C) 2017 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef STANDARDESE_TOOL_WATCHER_HPP_INCLUDED
+#define STANDARDESE_TOOL_WATCHER_HPP_INCLUDED
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "generator.hpp"
+
+namespace standardese_tool
+{
+    /// Watches directories for changes.
+    /// \notes This is only supported on Linux using inotify.
+    class file_watcher
+    {
+    public:
+        /// \effects Starts watching the given directories for changes.
+        /// Changes of the outputs of the cache and of files in its directory are ignored,
+        /// as they are written by the tool itself.
+        /// \throws `std::runtime_error` if watching isn't supported.
+        file_watcher(const std::set<std::string>& directories, const cache& c);
+
+        ~file_watcher() noexcept;
+
+        file_watcher(const file_watcher&) = delete;
+        file_watcher& operator=(const file_watcher&) = delete;
+
+        /// \effects Blocks until a file in one of the directories changed
+        /// since the watcher was created or `wait()` returned.
+        /// Changes that happen shortly after each other are combined.
+        void wait();
+
+    private:
+        // reads all pending events, returns false if there were only ignored ones
+        bool read_events();
+
+        bool is_ignored(const std::string& path) const;
+
+        std::map<int, std::string> directories_; //< watched directory of each descriptor
+        std::set<std::string>      ignored_;     //< canonical paths of the outputs
+        std::string                ignored_directory_;
+        const cache*               cache_;
+        int                        fd_;
+    };
+
+    /// \returns The directories that need watching to detect changes of the documentation:
+    /// the given input paths and the directories containing inputs or their includes.
+    std::set<std::string> get_watched_directories(const std::vector<fs::path>& input_paths,
+                                                  const std::vector<input_file>& input,
+                                                  const cache&                   c);
+} // namespace standardese_tool
+
+#endif // STANDARDESE_TOOL_WATCHER_HPP_INCLUDED